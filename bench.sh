@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Times the transpiler on generated programs of growing size
+# Doubling the size should roughly double the time - anything worse is a
+# quadratic sneaking back in.
+#
+# Usage: ./bench.sh [chain|nested|deep|lines] [sizes...]
+
+MODE=${1:-chain}
+shift
+# Past ~1500 the nested modes run out of parser stack
+SIZES=${@:-250 500 1000}
+
+# s = "a" + str(x) + "a" + str(x) + ...
+chain() {
+  awk -v n=$1 'BEGIN {
+    printf "x = 1\ns = \"a\""
+    for (i = 1; i < n; i++) printf " + str(x) + \"a\""
+    printf "\nprint(s)\n"
+  }'
+}
+
+# s = str("a" + str("a" + str(... x)))
+nested() {
+  awk -v n=$1 'BEGIN {
+    printf "x = 1\ns = "
+    for (i = 0; i < n; i++) printf "str(\"a\" + "
+    printf "str(x)"
+    for (i = 0; i < n; i++) printf ")"
+    printf "\nprint(s)\n"
+  }'
+}
+
+# x = 0, then blocks nested n deep, each looking up the names from above
+# The indentation alone makes the output quadratic, so expect a bit worse
+# than linear here
+deep() {
+  awk -v n=$1 'BEGIN {
+    printf "x = 0\n"
+    for (i = 0; i < n; i++) {
+      indent = sprintf("%" i "s", "")
+      printf "%sif x < %d:\n", indent, n
+      printf "%s y%d = x + 1\n", indent, i
+    }
+    printf "print(x)\n"
+  }'
+}
+
+# One function whose block is n statements long, then an n element list
+# Try sizes up to 1000000 - the stack use should stay flat
+lines() {
+  awk -v n=$1 'BEGIN {
+    printf "def f(x: int) -> int:\n"
+    for (i = 0; i < n; i++) printf "  x = x + %d\n", i
+    printf "  return x\n"
+    printf "xs = [0"
+    for (i = 1; i < n; i++) printf ", %d", i
+    printf "]\nprint(f(len(xs)))\n"
+  }'
+}
+
+case $MODE in
+  chain|nested|deep|lines) ;;
+  *)
+    echo "Unknown mode: $MODE" >&2
+    exit 1
+    ;;
+esac
+
+INPUT=$(mktemp)
+trap 'rm -f $INPUT' EXIT
+
+printf "%-10s %s\n" size seconds
+for n in $SIZES; do
+  $MODE $n > $INPUT
+  start=$(date +%s.%N)
+  ./bin/javelinParser < $INPUT > /dev/null || exit 1
+  end=$(date +%s.%N)
+  awk -v n=$n -v s=$start -v e=$end 'BEGIN { printf "%-10s %.3f\n", n, e - s }'
+done
@@ -20,4 +20,4 @@ while getopts ":o:" opt; do
   esac
 done
 
-./bin/scopeParser < $1 | ./bin/javelinParser | g++ -o $OUTPUT -std=c++11 -O3 -xc++ -
+./bin/javelinParser < $1 | g++ -o $OUTPUT -std=c++11 -O3 -xc++ -
@@ -1,24 +1,937 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <tuple>
 #include <vector>
+#include <initializer_list>
 #include <iterator>
+#include <utility>
 namespace javelin {
-  int modulus (int a, int b) {
+  constexpr int modulus (int a, int b) {
     // To make modulus behave the same was as Python3 modulus
     return ((a % b) + b) % b;
   }
 
-  // To allow iterating strings as strings, instead of chars
+  // A single character of a string, only made into a std::string on demand
+  class character {
+  public:
+    char value;
+
+    explicit character(char value) : value(value) {}
+
+    operator std::string() const {
+      return std::string(1, value);
+    }
+
+    size_t length() const {
+      return 1;
+    }
+  };
+
+  inline bool operator==(character lhs, character rhs) {
+    return lhs.value == rhs.value;
+  }
+  inline bool operator==(character lhs, const std::string &rhs) {
+    return rhs.length() == 1 && rhs[0] == lhs.value;
+  }
+  inline bool operator==(const std::string &lhs, character rhs) {
+    return rhs == lhs;
+  }
+  inline bool operator!=(character lhs, character rhs) {
+    return !(lhs == rhs);
+  }
+  inline bool operator!=(character lhs, const std::string &rhs) {
+    return !(lhs == rhs);
+  }
+  inline bool operator!=(const std::string &lhs, character rhs) {
+    return !(lhs == rhs);
+  }
+
+  inline std::string operator+(character lhs, character rhs) {
+    std::string result(1, lhs.value);
+    result += rhs.value;
+    return result;
+  }
+  inline std::string operator+(character lhs, const std::string &rhs) {
+    std::string result;
+    result.reserve(rhs.length() + 1);
+    result += lhs.value;
+    result += rhs;
+    return result;
+  }
+  // Taken by value, so a temporary on the left gets appended to in place
+  inline std::string operator+(std::string lhs, character rhs) {
+    lhs += rhs.value;
+    return lhs;
+  }
+
+  // Ordered like the one letter strings they stand for
+  inline bool operator<(character lhs, character rhs) {
+    return lhs.value < rhs.value;
+  }
+  inline bool operator>(character lhs, character rhs) {
+    return rhs < lhs;
+  }
+  inline bool operator<=(character lhs, character rhs) {
+    return !(rhs < lhs);
+  }
+  inline bool operator>=(character lhs, character rhs) {
+    return !(lhs < rhs);
+  }
+  inline bool operator<(character lhs, const std::string &rhs) {
+    return std::string(lhs) < rhs;
+  }
+  inline bool operator<(const std::string &lhs, character rhs) {
+    return lhs < std::string(rhs);
+  }
+  inline bool operator>(character lhs, const std::string &rhs) {
+    return rhs < lhs;
+  }
+  inline bool operator>(const std::string &lhs, character rhs) {
+    return rhs < lhs;
+  }
+  inline bool operator<=(character lhs, const std::string &rhs) {
+    return !(rhs < lhs);
+  }
+  inline bool operator<=(const std::string &lhs, character rhs) {
+    return !(rhs < lhs);
+  }
+  inline bool operator>=(character lhs, const std::string &rhs) {
+    return !(lhs < rhs);
+  }
+  inline bool operator>=(const std::string &lhs, character rhs) {
+    return !(lhs < rhs);
+  }
+
+  inline std::ostream& operator<<(std::ostream &out, character c) {
+    return out << c.value;
+  }
+
+  // Python's IndexError
+  class index_error : public std::out_of_range {
+  public:
+    explicit index_error(const char *what) : std::out_of_range(what) {}
+  };
+
+  // Kept out of line, so the checks stay small where they're inlined
+  [[noreturn]] __attribute__((noinline, cold))
+  inline void raise_index_error(const char *what) {
+    throw index_error(what);
+  }
+
+  // Where xs[i] is - a negative i counts back from the end
+  inline size_t checked_index(long long i, size_t size, const char *what) {
+    if (i < 0) i += size;
+    if (__builtin_expect(i < 0 || (size_t)i >= size, 0)) {
+      raise_index_error(what);
+    }
+    return i;
+  }
+
+  // xs[i], as Python does it
+  template <class List>
+  auto index(const List &xs, int i) -> decltype(xs[0]) {
+    return xs[checked_index(i, xs.size(), "list index out of range")];
+  }
+
+  inline character index(const std::string &s, int i) {
+    return character(s[checked_index(i, s.length(), "string index out of range")]);
+  }
+
+  // xs[start:] - the stop an omitted one stands for
+  const int to_end = std::numeric_limits<int>::max();
+
+  // Where xs[start:stop] starts and stops in xs, as Python works it out
+  inline void slice_bounds(long long start, long long stop, size_t size,
+                           size_t &from, size_t &to) {
+    long long length = size;
+    if (start < 0) start += length;
+    if (stop < 0) stop += length;
+    from = std::min(std::max(start, 0LL), length);
+    to = std::min(std::max(stop, (long long)from), length);
+  }
+
+  /*
+   * A slice of a list, pointing into the list it was taken from
+   * It only becomes a list of its own when it is kept as one.
+   */
+  template <class T>
+  class list_view {
+    const T *items;
+    size_t count;
+
+  public:
+    typedef std::vector<T> list;
+
+    list_view(const T *items, size_t count) : items(items), count(count) {}
+
+    size_t size() const {
+      return count;
+    }
+
+    const T& operator[](size_t i) const {
+      return items[i];
+    }
+
+    const T *begin() const {
+      return items;
+    }
+    const T *end() const {
+      return items + count;
+    }
+
+    operator list() const {
+      return list(begin(), end());
+    }
+  };
+
+  // The same for strings, which comes out as characters
+  class string_view {
+    const char *chars;
+    size_t count;
+
+  public:
+    string_view(const char *chars, size_t count) : chars(chars), count(count) {}
+
+    size_t length() const {
+      return count;
+    }
+    size_t size() const {
+      return count;
+    }
+
+    char operator[](size_t i) const {
+      return chars[i];
+    }
+
+    const char *data() const {
+      return chars;
+    }
+
+    operator std::string() const {
+      return std::string(chars, count);
+    }
+  };
+
+  inline character index(const string_view &s, int i) {
+    return character(s[checked_index(i, s.length(), "string index out of range")]);
+  }
+
+  // How many values range(start, stop, step) has
+  inline int range_count(int start, int stop, int step) {
+    if (step == 0) {
+      throw std::invalid_argument("range() arg 3 must not be zero");
+    }
+    if (step > 0) {
+      return start < stop ? ((long long)stop - start + step - 1) / step : 0;
+    } else {
+      return start > stop ? ((long long)start - stop - step - 1) / -(long long)step : 0;
+    }
+  }
+
+  /*
+   * range() used as a value
+   * Nothing is stored but the bounds - it only turns into a vector (reserved
+   * up front) when it is assigned or passed as a list.
+   */
+  class range {
+    // Counts the values off, as stepping past the last one could overflow
+    class iterator : public std::iterator<std::input_iterator_tag, int, std::ptrdiff_t, const int*, int> {
+      const range *r;
+      size_t i;
+    public:
+      iterator(const range *r, size_t i) : r(r), i(i) {}
+      iterator& operator++() {
+        i++;
+        return *this;
+      }
+      iterator operator++(int) {
+        iterator retval = *this;
+        ++(*this);
+        return retval;
+      }
+      bool operator==(iterator other) const {
+        return i == other.i;
+      }
+      bool operator!=(iterator other) const {
+        return !(*this == other);
+      }
+      reference operator*() const {
+        return (*r)[i];
+      }
+    };
+
+  public:
+    int start, stop, step;
+
+    range(int stop) : start(0), stop(stop), step(1) {}
+    range(int start, int stop, int step = 1)
+      : start(start), stop(stop), step(step) {
+      range_count(start, stop, step); // Just to reject a zero step
+    }
+
+    size_t size() const {
+      return range_count(start, stop, step);
+    }
+
+    int operator[](size_t i) const {
+      return start + (long long)i * step;
+    }
+
+    iterator begin() const {
+      return iterator(this, 0);
+    }
+    iterator end() const {
+      return iterator(this, size());
+    }
+
+    operator std::vector<int>() const {
+      std::vector<int> values;
+      values.reserve(size());
+      for (int value : *this) values.push_back(value);
+      return values;
+    }
+  };
+
+  /*
+   * Part of a matrix - a row, a plane, ... or the whole thing
+   * Points into the matrix's buffer, so indexing one never copies anything.
+   * It only becomes real lists when it is kept as one.
+   */
+  template <class T, int N>
+  class matrix_view {
+    const T *cells;
+    // This view's extents and strides, outermost first
+    const size_t *shape;
+    const size_t *strides;
+
+  public:
+    typedef matrix_view<T, N - 1> item;
+    typedef std::vector<typename item::list> list;
+
+    class iterator : public std::iterator<std::input_iterator_tag, item, std::ptrdiff_t, const item*, item> {
+      matrix_view view;
+      size_t i;
+    public:
+      iterator(const matrix_view &view, size_t i) : view(view), i(i) {}
+      iterator& operator++() {
+        i++;
+        return *this;
+      }
+      iterator operator++(int) {
+        iterator retval = *this;
+        ++(*this);
+        return retval;
+      }
+      bool operator==(iterator other) const {
+        return i == other.i;
+      }
+      bool operator!=(iterator other) const {
+        return !(*this == other);
+      }
+      item operator*() const {
+        return view[i];
+      }
+    };
+
+    matrix_view(const T *cells, const size_t *shape, const size_t *strides)
+      : cells(cells), shape(shape), strides(strides) {}
+
+    size_t size() const {
+      return shape[0];
+    }
+
+    item operator[](size_t i) const {
+      return item(cells + i * strides[0], shape + 1, strides + 1);
+    }
+
+    iterator begin() const {
+      return iterator(*this, 0);
+    }
+    iterator end() const {
+      return iterator(*this, size());
+    }
+
+    operator list() const {
+      list values;
+      values.reserve(size());
+      for (item row : *this) values.push_back(row);
+      return values;
+    }
+  };
+
+  // A single row, which is just a run of cells
+  template <class T>
+  class matrix_view<T, 1> {
+    const T *cells;
+    const size_t *shape;
+
+  public:
+    typedef std::vector<T> list;
+
+    // A row's cells are next to each other, so it has no use for strides
+    matrix_view(const T *cells, const size_t *shape, const size_t *)
+      : cells(cells), shape(shape) {}
+
+    size_t size() const {
+      return shape[0];
+    }
+
+    const T& operator[](size_t i) const {
+      return cells[i];
+    }
+
+    const T *begin() const {
+      return cells;
+    }
+    const T *end() const {
+      return cells + size();
+    }
+
+    operator list() const {
+      return list(begin(), end());
+    }
+  };
+
+  /*
+   * A rectangular list of lists (of lists...), in one flat buffer
+   * m(i, j) is a single strided lookup, rather than a pointer chase per
+   * level like std::vector<std::vector<T>> needs.
+   */
+  template <class T, int N>
+  class matrix {
+    std::vector<T> cells;
+    size_t shape[N];
+    size_t strides[N];
+
+  public:
+    // The cells go in row by row
+    matrix(std::initializer_list<size_t> extents, std::initializer_list<T> values)
+      : cells(values) {
+      std::copy(extents.begin(), extents.end(), shape);
+      size_t stride = 1;
+      for (int d = N - 1; d >= 0; d--) {
+        strides[d] = stride;
+        stride *= shape[d];
+      }
+    }
+
+    // Views point inside it, so it stays put
+    matrix(const matrix&) = delete;
+    matrix& operator=(const matrix&) = delete;
+
+    matrix_view<T, N> view() const {
+      return matrix_view<T, N>(cells.data(), shape, strides);
+    }
+
+    size_t size() const {
+      return shape[0];
+    }
+
+    typename matrix_view<T, N>::item operator[](size_t i) const {
+      return view()[i];
+    }
+
+    template <class... Index>
+    const T& operator()(Index... index) const {
+      static_assert(sizeof...(Index) == N, "A matrix cell needs an index per dimension");
+      size_t at[] = {(size_t)index...};
+      size_t offset = 0;
+      for (int d = 0; d < N; d++) offset += at[d] * strides[d];
+      return cells[offset];
+    }
+
+    // The same, checking each index against its own extent
+    template <class... Index>
+    const T& at(Index... index) const {
+      static_assert(sizeof...(Index) == N, "A matrix cell needs an index per dimension");
+      long long indices[] = {(long long)index...};
+      size_t offset = 0;
+      for (int d = 0; d < N; d++) {
+        offset += checked_index(indices[d], shape[d], "list index out of range") * strides[d];
+      }
+      return cells[offset];
+    }
+
+    typename matrix_view<T, N>::iterator begin() const {
+      return view().begin();
+    }
+    typename matrix_view<T, N>::iterator end() const {
+      return view().end();
+    }
+  };
+
+  // m[i][j]..., as Python does it
+  template <class T, int N, class... Index>
+  const T& index(const matrix<T, N> &m, Index... i) {
+    return m.at(i...);
+  }
+
+  /*
+   * xs[start:stop]
+   * Anything that stays put is looked at in place - only a temporary has
+   * to be cut down and handed back whole, as nothing else keeps it alive.
+   */
+  template <class T>
+  list_view<T> slice(const std::vector<T> &xs, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, xs.size(), from, to);
+    return list_view<T>(xs.data() + from, to - from);
+  }
+
+  template <class T>
+  std::vector<T> slice(std::vector<T> &&xs, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, xs.size(), from, to);
+    xs.erase(xs.begin() + to, xs.end());
+    xs.erase(xs.begin(), xs.begin() + from);
+    return std::move(xs);
+  }
+
+  template <class T, size_t N>
+  list_view<T> slice(const std::array<T, N> &xs, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, N, from, to);
+    return list_view<T>(xs.data() + from, to - from);
+  }
+
+  template <class T>
+  list_view<T> slice(const list_view<T> &xs, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, xs.size(), from, to);
+    return list_view<T>(xs.begin() + from, to - from);
+  }
+
+  inline range slice(const range &r, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, r.size(), from, to);
+    return range(r[from], r[to], r.step);
+  }
+
+  // A matrix row is a run of cells, but anything bigger isn't laid out as
+  // the lists a slice of it is made of
+  template <class T>
+  list_view<T> slice(const matrix_view<T, 1> &row, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, row.size(), from, to);
+    return list_view<T>(row.begin() + from, to - from);
+  }
+
+  template <class T, int N>
+  typename matrix_view<T, N>::list slice(const matrix_view<T, N> &view, int start, int stop) {
+    return slice(typename matrix_view<T, N>::list(view), start, stop);
+  }
+
+  template <class T, int N>
+  typename matrix_view<T, N>::list slice(const matrix<T, N> &m, int start, int stop) {
+    return slice(m.view(), start, stop);
+  }
+
+  inline string_view slice(const std::string &s, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, s.length(), from, to);
+    return string_view(s.data() + from, to - from);
+  }
+
+  inline std::string slice(std::string &&s, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, s.length(), from, to);
+    s.erase(to);
+    s.erase(0, from);
+    return std::move(s);
+  }
+
+  inline string_view slice(const string_view &s, int start, int stop) {
+    size_t from, to;
+    slice_bounds(start, stop, s.length(), from, to);
+    return string_view(s.data() + from, to - from);
+  }
+
+  // s[i][start:stop]
+  inline std::string slice(character c, int start, int stop) {
+    return slice(std::string(c), start, stop);
+  }
+
+  /*
+   * Writes the digits of value so they end just before end, and returns
+   * where they start - no locales or streams involved
+   */
+  inline char *format_int(long long value, char *end) {
+    char *start = end;
+    unsigned long long magnitude = value < 0 ? -(unsigned long long)value : value;
+    do {
+      *--start = '0' + magnitude % 10;
+      magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--start = '-';
+    return start;
+  }
+
+  // Enough for any long long, sign included
+  const size_t int_digits = 24;
+
+  /*
+   * Buffered stdout for print()
+   * Only written out when it fills up, on flush=True, or at exit.
+   */
+  class output {
+    static const size_t capacity = 1 << 16;
+    char buffer[capacity];
+    size_t used;
+
+  public:
+    output() : used(0) {
+      // Nothing reads stdin expecting stdout to have been flushed first
+      std::cin.tie(NULL);
+    }
+
+    ~output() {
+      flush();
+    }
+
+    void flush() {
+      fwrite(buffer, 1, used, stdout);
+      fflush(stdout);
+      used = 0;
+    }
+
+    void put(char c) {
+      if (used == capacity) flush();
+      buffer[used++] = c;
+    }
+
+    void write(const char *data, size_t length) {
+      if (used + length > capacity) {
+        flush();
+        // Too big to be worth buffering
+        if (length > capacity) {
+          fwrite(data, 1, length, stdout);
+          return;
+        }
+      }
+      memcpy(buffer + used, data, length);
+      used += length;
+    }
+
+    void write(const std::string &s) {
+      write(s.data(), s.length());
+    }
+
+    void write(const string_view &s) {
+      write(s.data(), s.length());
+    }
+
+    void write(character c) {
+      put(c.value);
+    }
+
+    void write(long long value) {
+      char digits[int_digits];
+      char *end = digits + int_digits;
+      char *start = format_int(value, end);
+      write(start, end - start);
+    }
+  };
+
+  // Lives until exit, which is when it writes out whatever is left
+  inline output& out() {
+    static output stdout_buffer;
+    return stdout_buffer;
+  }
+
+  /*
+   * What an error that nothing catches does - as with Python, whatever was
+   * printed before it still comes out, and the exit code is 1
+   */
+  [[noreturn]] inline void uncaught() {
+    out().flush();
+    try {
+      if (std::current_exception()) throw;
+    } catch (const index_error &e) {
+      fprintf(stderr, "IndexError: %s\n", e.what());
+    } catch (const std::exception &e) {
+      fprintf(stderr, "%s\n", e.what());
+    } catch (...) {
+    }
+    std::_Exit(1);
+  }
+
+  static const std::terminate_handler default_terminate = std::set_terminate(uncaught);
+
+  inline void print_args() {}
+
+  template <class T>
+  void print_args(const T &first) {
+    out().write(first);
+  }
+
+  // As per python, place spaces between the outputs
+  template <class T, class... Rest>
+  void print_args(const T &first, const Rest&... rest) {
+    out().write(first);
+    out().put(' ');
+    print_args(rest...);
+  }
+
+  template <class... Args>
+  void print(const Args&... args) {
+    print_args(args...);
+    out().put('\n');
+  }
+
+  // print(..., flush=flush)
+  template <class... Args>
+  void print_flush(bool flush, const Args&... args) {
+    print(args...);
+    if (flush) out().flush();
+  }
+
+  // The parts concat() accepts - how long each is, and how to add it on
+  inline size_t concat_length(const std::string &s) { return s.length(); }
+  inline size_t concat_length(const string_view &s) { return s.length(); }
+  inline size_t concat_length(const char *s) { return strlen(s); }
+  inline size_t concat_length(char) { return 1; }
+  inline size_t concat_length(character) { return 1; }
+  inline size_t concat_length(long long value) {
+    size_t length = value < 0 ? 2 : 1;
+    for (value /= 10; value != 0; value /= 10) length++;
+    return length;
+  }
+  inline size_t concat_length(int value) { return concat_length((long long)value); }
+
+  inline void concat_append(std::string &out, const std::string &s) { out += s; }
+  inline void concat_append(std::string &out, const string_view &s) {
+    out.append(s.data(), s.length());
+  }
+  inline void concat_append(std::string &out, const char *s) { out += s; }
+  inline void concat_append(std::string &out, char c) { out += c; }
+  inline void concat_append(std::string &out, character c) { out += c.value; }
+  inline void concat_append(std::string &out, long long value) {
+    char digits[int_digits];
+    char *end = digits + int_digits;
+    char *start = format_int(value, end);
+    out.append(start, end - start);
+  }
+  inline void concat_append(std::string &out, int value) {
+    concat_append(out, (long long)value);
+  }
+
+  // Whether a part is, or points into, out - so appending to out would
+  // change it along the way
+  template <class Part>
+  bool aliases(const std::string &, const Part&) {
+    return false;
+  }
+  inline bool aliases(const std::string &out, const std::string &s) {
+    return &s == &out;
+  }
+  inline bool aliases(const std::string &out, const string_view &s) {
+    std::less_equal<const char*> before;
+    return before(out.data(), s.data()) && before(s.data(), out.data() + out.length());
+  }
+
+  /*
+   * out += a + str(b) + "c" + ... in place
+   * Everything is measured first, so out grows at most once, and ints are
+   * formatted straight into it.
+   */
+  template <class... Parts>
+  void append(std::string &out, const Parts&... parts) {
+    size_t lengths[] = {concat_length(parts)...};
+    size_t total = out.length();
+    for (size_t length : lengths) total += length;
+
+    bool aliased[] = {aliases(out, parts)...};
+    if (std::find(std::begin(aliased), std::end(aliased), true) != std::end(aliased)) {
+      // s += "-" + s or s += s[i:] - built somewhere else, and swapped in
+      std::string result;
+      result.reserve(std::max(total, 2 * out.capacity()));
+      result += out;
+      append(result, parts...);
+      out.swap(result);
+      return;
+    }
+
+    if (total > out.capacity()) {
+      // Still grow geometrically, appending in a loop has to stay linear
+      out.reserve(std::max(total, 2 * out.capacity()));
+    }
+    // Expanded in a braced list, to append left to right without recursing
+    int appended[] = {(concat_append(out, parts), 0)...};
+    (void)appended;
+  }
+
+  // a + str(b) + "c" + ... in one go, with a single allocation
+  template <class... Parts>
+  std::string concat(const Parts&... parts) {
+    std::string result;
+    append(result, parts...);
+    return result;
+  }
+
+  // xs += ys
+  template <class T>
+  void extend(std::vector<T> &xs, const std::vector<T> &ys) {
+    if (&xs == &ys) {
+      // Inserting a vector's own range into itself isn't allowed
+      size_t length = xs.size();
+      xs.reserve(2 * length);
+      for (size_t i = 0; i < length; i++) xs.push_back(xs[i]);
+    } else {
+      xs.insert(xs.end(), ys.begin(), ys.end());
+    }
+  }
+
+  template <class T>
+  void extend(std::vector<T> &xs, const range &r) {
+    xs.reserve(xs.size() + r.size());
+    for (int value : r) xs.push_back(value);
+  }
+
+  // xs += m[i], each item turning into a list as it goes in
+  template <class T, class U, int N>
+  void extend(std::vector<T> &xs, const matrix_view<U, N> &view) {
+    xs.reserve(xs.size() + view.size());
+    for (auto item : view) xs.push_back(item);
+  }
+
+  // xs += ys[i:j], which might be a slice of xs itself
+  template <class T>
+  void extend(std::vector<T> &xs, const list_view<T> &ys) {
+    std::less_equal<const T*> before;
+    if (before(xs.data(), ys.begin()) && before(ys.begin(), xs.data() + xs.size())) {
+      std::vector<T> copy(ys);
+      xs.insert(xs.end(), copy.begin(), copy.end());
+    } else {
+      xs.insert(xs.end(), ys.begin(), ys.end());
+    }
+  }
+
+  // A temporary can give up its elements
+  template <class T>
+  void extend(std::vector<T> &xs, std::vector<T> &&ys) {
+    xs.insert(xs.end(), std::make_move_iterator(ys.begin()),
+              std::make_move_iterator(ys.end()));
+  }
+
+  /*
+   * Remembers what a pure function handed back for each set of arguments
+   * Open addressing with linear probing, in a power of two table that
+   * doubles whenever it gets half full.
+   */
+  template <class Signature>
+  class memo;
+
+  template <class R, class... Args>
+  class memo<R(Args...)> {
+    typedef std::tuple<Args...> key_type;
+
+    struct slot {
+      size_t hash;
+      bool full;
+      key_type key;
+      R value;
+
+      slot() : hash(0), full(false) {}
+    };
+
+    std::vector<slot> slots;
+    size_t count;
+
+    static size_t hash_args() {
+      return 0;
+    }
+
+    template <class T, class... Rest>
+    static size_t hash_args(const T &first, const Rest&... rest) {
+      return hash_args(rest...) * 31 + std::hash<T>()(first);
+    }
+
+    // std::hash<int> is the int itself, which would fill the table in runs
+    static size_t mix(unsigned long long h) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+    slot *find(size_t hash, const Args&... args) {
+      if (slots.empty()) return NULL;
+      size_t mask = slots.size() - 1;
+      for (size_t i = hash & mask; slots[i].full; i = (i + 1) & mask) {
+        if (slots[i].hash == hash && slots[i].key == std::tie(args...)) {
+          return &slots[i];
+        }
+      }
+      return NULL;
+    }
+
+    void place(slot &&s) {
+      size_t mask = slots.size() - 1;
+      size_t i = s.hash & mask;
+      while (slots[i].full) i = (i + 1) & mask;
+      slots[i] = std::move(s);
+    }
+
+    void grow() {
+      std::vector<slot> old(std::max<size_t>(16, slots.size() * 2));
+      old.swap(slots);
+      for (slot &s : old) {
+        if (s.full) place(std::move(s));
+      }
+    }
+
+  public:
+    memo() : count(0) {}
+
+    // The value for args, only calling compute() the first time they're seen
+    template <class F>
+    R operator()(F compute, const Args&... args) {
+      size_t hash = mix(hash_args(args...));
+      slot *hit = find(hash, args...);
+      if (hit) return hit->value;
+
+      // Copied first, as the function is free to change its arguments
+      slot s;
+      s.hash = hash;
+      s.full = true;
+      s.key = key_type(args...);
+      // This can recurse, and grow the table under us
+      s.value = compute();
+      R value = s.value;
+
+      if ((count + 1) * 2 > slots.size()) grow();
+      place(std::move(s));
+      count++;
+      return value;
+    }
+  };
+
+  /*
+   * To allow iterating strings as strings, instead of chars
+   * Borrows the string (or slice) it is given, unless it is a temporary -
+   * that one has to be kept alive for the loop, so it gets moved in.
+   */
   class string_itr {
-    std::string val;
+    std::string owned;
+    bool owning;
+    const char *chars;
+    size_t count;
 
-    class iterator : public std::iterator<std::input_iterator_tag, std::string, std::string, const std::string*, std::string> {
-      std::string val;
-      size_t index;
+    class iterator : public std::iterator<std::input_iterator_tag, character, std::ptrdiff_t, const char*, character> {
+      const char *pos;
     public:
-      iterator(std::string val, size_t index) : val(val), index(index) {}
+      iterator(const char *pos) : pos(pos) {}
       iterator& operator++() {
-        index++;
+        pos++;
         return *this;
       }
       iterator operator++(int) {
@@ -27,25 +940,34 @@ namespace javelin {
         return retval;
       }
       bool operator==(iterator other) const {
-        return index == other.index;
+        return pos == other.pos;
       }
       bool operator!=(iterator other) const {
         return !(*this == other);
       }
       reference operator*() const {
-        return std::string(1, val[index]);
+        return character(*pos);
       }
     };
 
   public:
 
-    string_itr(std::string val) : val(val) {}
+    string_itr(const std::string &val)
+      : owning(false), chars(val.data()), count(val.length()) {}
+    string_itr(const string_view &val)
+      : owning(false), chars(val.data()), count(val.length()) {}
+    string_itr(std::string &&val)
+      : owned(std::move(val)), owning(true), chars(owned.data()),
+        count(owned.length()) {}
+    string_itr(string_itr &&other)
+      : owned(std::move(other.owned)), owning(other.owning),
+        chars(owning ? owned.data() : other.chars), count(other.count) {}
 
-    iterator begin() {
-      return iterator(val, 0);
+    iterator begin() const {
+      return iterator(chars);
     }
-    iterator end() {
-      return iterator(val, val.length());
+    iterator end() const {
+      return iterator(chars + count);
     }
   };
 };
@@ -1,4 +1,4 @@
 #!/bin/sh
 
 cat $1
-./bin/scopeParser < $1 | tee /dev/tty | ./bin/javelinParser
+./bin/javelinParser < $1
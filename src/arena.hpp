@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Bump allocator for everything a transpile builds (nodes, types, scopes...)
+ * Nothing is freed individually - the whole arena is released at once when
+ * the transpile finishes. Objects that own memory of their own (strings,
+ * tables) get their destructors run first, newest to oldest.
+ */
+class Arena {
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Destructor {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  std::vector<char *> blocks;
+  std::vector<Destructor> destructors;
+  char *next;
+  char *end;
+  size_t reserved;
+
+  template <class T>
+  static void destroy(void *object) {
+    ((T *)object)->~T();
+  }
+
+  void *allocate(size_t size, size_t align) {
+    size_t padding = (align - (size_t)next % align) % align;
+    if (next == NULL || padding + size > (size_t)(end - next)) {
+      // Oversized objects get a block to themselves
+      size_t blockSize = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+      char *block = (char *)malloc(blockSize);
+      if (block == NULL) {
+        throw std::bad_alloc();
+      }
+      blocks.push_back(block);
+      reserved += blockSize;
+      next = block;
+      end = block + blockSize;
+      padding = (align - (size_t)next % align) % align;
+    }
+    void *memory = next + padding;
+    next += padding + size;
+    return memory;
+  }
+
+public:
+  Arena() : next(NULL), end(NULL), reserved(0) {}
+  Arena(const Arena &) = delete;
+  Arena& operator=(const Arena &) = delete;
+
+  ~Arena() {
+    for (auto itr = destructors.rbegin(); itr != destructors.rend(); itr++) {
+      itr->destroy(itr->object);
+    }
+    for (char *block : blocks) {
+      free(block);
+    }
+  }
+
+  // Construct a T in the arena. It lives until the arena is destroyed.
+  template <class T, class... Args>
+  T *make(Args&&... args) {
+    T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if ( ! std::is_trivially_destructible<T>::value) {
+      destructors.push_back({object, &destroy<T>});
+    }
+    return object;
+  }
+
+  // Bytes taken from the system, which only ever grows until release
+  size_t peak_bytes() {
+    return reserved;
+  }
+};
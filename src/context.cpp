@@ -0,0 +1,16 @@
+#include "context.hpp"
+
+thread_local Context *Context::active = NULL;
+
+Context::Context() :
+    currentScope(NULL), funcStack(NULL), beginFunctionScope(NULL),
+    lastFuncStack(NULL), specializing(NULL), types(arena), tokens(NULL),
+    nextToken(0), currentIndent(0), indentType(' '), indentMultiplicity(0),
+    pendingDedents(0), lexingStarted(false), uncountedLines(0) {
+  previous = active;
+  active = this;
+}
+
+Context::~Context() {
+  active = previous;
+}
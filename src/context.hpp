@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+#include "javelin.hpp"
+#include "literal.hpp"
+#include "symbol.hpp"
+#include "type.hpp"
+
+class Scope;
+class FunctionScope;
+class FunctionStack;
+class NStatement;
+class NFunctionDeclStatement;
+class NAssignment;
+class GenericFunctionDefinition;
+
+// A token as the lexer read it, with what's needed to make its value
+struct Token {
+  int kind;
+  // The lexer's line count once it had been read
+  int line;
+  // The name of an ID, or the text of a STRING
+  std::string text;
+  // The value of an INTEGER, or the operator of an AUG_ASSIGN
+  long long value;
+
+  Token() : kind(0), line(0), value(0) {}
+};
+
+/*
+ * Everything a single transpile needs, so that several can run at once
+ * Creating a context makes it the current one for this thread, until it is
+ * destroyed.
+ */
+class Context {
+  static thread_local Context *active;
+  Context *previous;
+
+public:
+  // Backs every node, type, scope and definition - so it goes first, and
+  // is released last
+  Arena arena;
+
+  /*
+   * The top scope - it will change when the parser enters a new block
+   * Statements and expressions latch on to this, but it "moves up and down"
+   */
+  Scope *currentScope;
+  FunctionStack *funcStack;
+  // Set by a function declaration, so its block uses the function's scope
+  FunctionScope *beginFunctionScope;
+  // Keep the last popped function around for type implications
+  FunctionStack *lastFuncStack;
+  // The generic function being specialized, and the types it's for - the
+  // next function declared picks these up
+  GenericFunctionDefinition *specializing;
+  std::vector<Type *> specializingTypes;
+
+  // Every type used by this transpile
+  TypeContext types;
+  // Every identifier name seen by the lexer
+  SymbolTable symbols;
+  // Every string literal, hoisted out of the code that uses it
+  LiteralTable literals;
+
+  std::vector<NStatement*> rootStmts; // Main program blocks
+  std::vector<NFunctionDeclStatement*> rootFuncStmts;
+  // Every function, nested ones included
+  std::vector<NFunctionDeclStatement*> funcStmts;
+  std::vector<NAssignment*> rootAssignStmts;
+
+  // The tokens the parser takes from, and how many it has had
+  const std::vector<Token> *tokens;
+  size_t nextToken;
+
+  // Lexer indentation tracking
+  int currentIndent;
+  // Set to ' ' or '\t'
+  char indentType;
+  // Set to some integer, on the first indent.
+  int indentMultiplicity;
+  // Dedents still owed to the parser, when several blocks close at once
+  int pendingDedents;
+  // The first token has to start off at the beginning of a line
+  bool lexingStarted;
+  /*
+   * Newlines are only counted once the next line starts, so errors raised
+   * on an EOL lookahead still report the line of the statement.
+   */
+  int uncountedLines;
+
+  // What the caller asked for
+  javelin::Options options;
+
+  // The first parse error, if any
+  std::string error;
+
+  Context();
+  ~Context();
+
+  // Allocate anything that should live as long as the transpile
+  template <class T, class... Args>
+  T *make(Args&&... args) {
+    return arena.make<T>(std::forward<Args>(args)...);
+  }
+
+  // The context of the transpile running on this thread
+  static Context *current() {
+    return active;
+  }
+};
+
+// Parses more tokens into the running transpile, in scope - as if they had
+// been there all along
+void parse_more(Context *ctx, const std::vector<Token> &tokens, Scope *scope);
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "node.hpp"
+#include "passes.hpp"
+
+// Counts what a walk visits, to skip over it
+class ExpressionCounter : public NVisitor {
+public:
+  size_t count;
+
+  ExpressionCounter() : count(0) {}
+
+  virtual void visit(NExpression *expr) {
+    count++;
+  }
+};
+
+/*
+ * Walks everything that can run, starting from the top level statements
+ * Functions are only walked once something reachable calls them, and a
+ * store that does nothing but store is only walked once its variable is
+ * read - so what is left unmarked at the end is dead.
+ */
+class LiveCode : public NVisitor {
+public:
+  // Reached, but not walked yet
+  std::vector<NFunctionDeclStatement *> pending;
+  // What gets stored to each variable not read so far, to walk if it is
+  std::unordered_map<Definition *, std::vector<NStatement *>> deferred;
+  // How many expressions the walk has left to pass over, as they're part
+  // of a store that's been put off
+  size_t skipping;
+
+  LiveCode() : skipping(0) {}
+
+  virtual void visit(NStatement *stmt) {
+    stmt->mark_stores();
+
+    Definition *def = stmt->only_stores();
+    bool read = def && ((VariableDefinition *)def)->liveReads > 0;
+    if (stmt->dropped() || (def && ! read)) {
+      ExpressionCounter counter;
+      stmt->walk(counter);
+      skipping = counter.count;
+      if ( ! stmt->dropped()) deferred[def].push_back(stmt);
+    }
+  }
+
+  virtual void visit(NExpression *expr) {
+    if (skipping > 0) {
+      skipping--;
+      return;
+    }
+    expr->mark_live();
+
+    // Its stores matter now
+    Definition *def = expr->variable();
+    auto stores = def ? deferred.find(def) : deferred.end();
+    if (stores != deferred.end()) {
+      std::vector<NStatement *> stmts;
+      stmts.swap(stores->second);
+      deferred.erase(stores);
+      for (NStatement *stmt : stmts) {
+        stmt->walk(*this);
+      }
+    }
+
+    FunctionDefinition *called = expr->called();
+    NFunctionDeclStatement *callee = called ? called->stmt : NULL;
+    if (callee && ! callee->reachable) {
+      callee->reachable = true;
+      pending.push_back(callee);
+    }
+  }
+};
+
+// Takes every variable what it walks reads out of the set
+class ReadRemover : public NVisitor {
+public:
+  std::unordered_set<Definition *> &defs;
+
+  ReadRemover(std::unordered_set<Definition *> &defs) : defs(defs) {}
+
+  virtual void visit(NStatement *stmt) {
+    // x += y reads x too
+    if (stmt->in_place()) defs.erase(stmt->stored());
+  }
+
+  virtual void visit(NExpression *expr) {
+    Definition *def = expr->variable();
+    if (def) defs.erase(def);
+  }
+};
+
+// Handed every statement, so every block - the ones in functions included
+class OverwrittenStores : public NVisitor {
+public:
+  virtual void visit(NStatement *stmt) {
+    stmt->drop_overwritten_stores();
+  }
+};
+
+/*
+ * x = 1 followed by x = 2 in the same block, with nothing reading x (or
+ * jumping elsewhere) in between, never has its 1 read. Goes back from the
+ * end, keeping what's stored over further on without being read first.
+ */
+static void drop_overwritten(std::vector<NStatement *> &stmts) {
+  std::unordered_set<Definition *> overwritten;
+  ReadRemover reads(overwritten);
+  for (size_t i = stmts.size(); i-- > 0; ) {
+    NStatement *stmt = stmts[i];
+    if (stmt->jumps()) {
+      overwritten.clear();
+      continue;
+    }
+
+    Definition *def = stmt->only_stores();
+    if (def && overwritten.count(def)) {
+      // Dropped, so what it reads isn't read after all
+      stmt->drop_store();
+      continue;
+    }
+
+    // Going back, its store comes before what it reads
+    Definition *stores = stmt->overwrites();
+    if (stores) overwritten.insert(stores);
+    stmt->walk(reads);
+  }
+}
+
+void NBlock::drop_overwritten_stores() {
+  drop_overwritten(stmts);
+}
+
+void NIdentifier::mark_live() {
+  Definition *def = resolve();
+  if (def && def->isVariable()) ((VariableDefinition *)def)->liveReads++;
+}
+
+// A store that has to happen anyway keeps the variable around
+void NAssignment::mark_stores() {
+  Definition *def = lhs->resolve();
+  if (def->isVariable() && rhs->has_side_effects()) {
+    ((VariableDefinition *)def)->effectfulStores = true;
+  }
+}
+
+void NAugAssignment::mark_stores() {
+  if (rhs->has_side_effects()) {
+    ((VariableDefinition *)lhs->resolve())->effectfulStores = true;
+  }
+}
+
+// Once nothing reads the variable, only what working the value out does is
+// worth keeping
+bool NAssignment::generates() {
+  VariableDefinition *vdef = (VariableDefinition *)lhs->resolve();
+  if (overwritten || vdef->isDead()) return false;
+  return vdef->liveReads > 0 || rhs->has_side_effects();
+}
+
+bool NAugAssignment::generates() {
+  VariableDefinition *vdef = (VariableDefinition *)lhs->resolve();
+  if (overwritten || vdef->isDead()) return false;
+  return vdef->liveReads > 0 || rhs->has_side_effects();
+}
+
+Definition *NAssignment::only_stores() {
+  Definition *def = lhs->resolve();
+  return def->isVariable() && ! rhs->has_side_effects() ? def : NULL;
+}
+
+Definition *NAssignment::overwrites() {
+  return inPlace ? NULL : lhs->resolve();
+}
+
+bool NIfStatement::jumps() {
+  return stmt->jumps() || (elifStmt && elifStmt->jumps())
+    || (elseStmt && elseStmt->jumps());
+}
+
+bool NElifStatement::jumps() {
+  return stmt->jumps() || (elifStmt && elifStmt->jumps())
+    || (elseStmt && elseStmt->jumps());
+}
+
+// A break in it only leaves the loop, but a return leaves more
+bool NWhileStatement::jumps() {
+  return stmt->jumps();
+}
+
+bool NForStatement::jumps() {
+  return stmt->jumps();
+}
+
+Definition *NAugAssignment::only_stores() {
+  return rhs->has_side_effects() ? NULL : lhs->resolve();
+}
+
+bool NExpressionArgs::has_side_effects() {
+  for (NExpression *expr : exprs) {
+    if (expr->has_side_effects()) return true;
+  }
+  for (NKeywordArg *arg : keywords) {
+    if (arg->value->has_side_effects()) return true;
+  }
+  return false;
+}
+
+bool NFunctionCallExpression::has_side_effects() {
+  return ! definition->isPure() || args->has_side_effects();
+}
+
+void eliminate_dead_code(Context *ctx) {
+  OverwrittenStores overwritten;
+  drop_overwritten(ctx->rootStmts);
+  for (NStatement *stmt : ctx->rootStmts) {
+    stmt->walk(overwritten);
+  }
+  for (NFunctionDeclStatement *stmt : ctx->rootFuncStmts) {
+    stmt->walk(overwritten);
+  }
+
+  LiveCode live;
+  for (NStatement *stmt : ctx->rootStmts) {
+    stmt->walk(live);
+  }
+  while ( ! live.pending.empty()) {
+    NFunctionDeclStatement *func = live.pending.back();
+    live.pending.pop_back();
+    func->stmt->walk(live);
+  }
+
+  // No header or body for the ones nothing calls
+  auto &funcs = ctx->rootFuncStmts;
+  funcs.erase(std::remove_if(funcs.begin(), funcs.end(),
+                             [](NFunctionDeclStatement *func) {
+                               return ! func->reachable;
+                             }),
+              funcs.end());
+}
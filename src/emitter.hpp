@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+/*
+ * Growable buffer the code generators write to
+ * It keeps track of the indentation level, and is written out in one go
+ * once the whole program has been generated.
+ */
+class Emitter {
+  std::string buffer;
+  int level;
+  // How many temporaries have been named so far
+  int temps;
+
+public:
+  Emitter() : level(0), temps(0) {}
+
+  Emitter& operator<<(const std::string &text) {
+    buffer += text;
+    return *this;
+  }
+  Emitter& operator<<(const char *text) {
+    buffer += text;
+    return *this;
+  }
+  Emitter& operator<<(char c) {
+    buffer += c;
+    return *this;
+  }
+  Emitter& operator<<(long long value) {
+    char digits[24];
+    buffer.append(digits, snprintf(digits, sizeof(digits), "%lld", value));
+    return *this;
+  }
+  Emitter& operator<<(int value) {
+    return *this << (long long)value;
+  }
+
+  // Blocks nest one level deeper than their parent statement
+  void indent() { level++; }
+  void dedent() { level--; }
+  int depth() { return level; }
+
+  // Starts a line at the current indentation
+  Emitter& line() {
+    buffer.append(2 * level, ' ');
+    return *this;
+  }
+
+  // A fresh name for a generated temporary, out of the way of the user's
+  std::string temp(const char *base) {
+    return std::string("javelin_") + base + '_' + std::to_string(++temps);
+  }
+
+  const std::string& str() {
+    return buffer;
+  }
+
+  // Write everything generated so far with a single call
+  bool write(FILE *file) {
+    return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+  }
+};
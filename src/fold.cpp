@@ -0,0 +1,319 @@
+#include <climits>
+#include <string>
+
+#include "node.hpp"
+#include "passes.hpp"
+
+/*
+ * Constant folding
+ * Every node folds its children, and hands back what should replace it.
+ * Ints are folded the way the generated C++ would work them out, so nothing
+ * that overflows (or divides by zero) gets folded at all.
+ */
+
+static bool fitsInt(long long value) {
+  return value >= INT_MIN && value <= INT_MAX;
+}
+
+static NExpression *makeInt(long long value) {
+  return Context::current()->make<NInteger>(value);
+}
+
+static NExpression *makeString(const string &value) {
+  return Context::current()->make<NString>(value);
+}
+
+// The value of l op r as C++ ints, if it is defined
+static bool foldInts(NOpType op, long long l, long long r, long long &value) {
+  switch (op) {
+  case N_LT:  value = l < r; break;
+  case N_GT:  value = l > r; break;
+  case N_EQ:  value = l == r; break;
+  case N_NEQ: value = l != r; break;
+  case N_GTE: value = l >= r; break;
+  case N_LTE: value = l <= r; break;
+  case N_AND: value = l && r; break;
+  case N_OR:  value = l || r; break;
+  case N_ADD: value = l + r; break;
+  case N_SUB: value = l - r; break;
+  case N_MUL: value = l * r; break;
+  case N_BA:  value = l & r; break;
+  case N_BO:  value = l | r; break;
+  case N_BX:  value = l ^ r; break;
+  case N_DIV:
+    if (r == 0 || (l == INT_MIN && r == -1)) return false;
+    value = l / r;
+    break;
+  case N_SL:
+    if (l < 0 || r < 0 || r >= 31) return false;
+    value = l << r;
+    break;
+  case N_SR:
+    if (l < 0 || r < 0 || r >= 31) return false;
+    value = l >> r;
+    break;
+  default:
+    return false;
+  }
+  return fitsInt(value);
+}
+
+NExpression *NBinaryOperator::fold() {
+  lhs = lhs->fold();
+  rhs = rhs->fold();
+
+  long long l, r, value;
+  if (lhs->const_int(l) && rhs->const_int(r) && fitsInt(l) && fitsInt(r)
+      && foldInts(op, l, r, value)) {
+    return makeInt(value);
+  }
+
+  string ls, rs;
+  if (lhs->const_str(ls) && rhs->const_str(rs)) {
+    switch (op) {
+    case N_ADD: return makeString(ls + rs);
+    case N_EQ:  return makeInt(ls == rs);
+    case N_NEQ: return makeInt(ls != rs);
+    default:    break;
+    }
+  }
+  return this;
+}
+
+NExpression *NUnaryOperator::fold() {
+  rhs = rhs->fold();
+
+  long long value;
+  if ( ! rhs->const_int(value) || ! fitsInt(value)) return this;
+  switch (op) {
+  case N_SUB: return fitsInt(-value) ? makeInt(-value) : this;
+  case N_NOT: return makeInt(! value);
+  case N_BN:  return makeInt(~value);
+  default:    return this;
+  }
+}
+
+NExpression *NIdentifier::fold() {
+  // Only ever assigned the one constant, so that's all it can be
+  Definition *def = resolve();
+  if (def == NULL || ! def->isVariable()) return this;
+  VariableDefinition *vdef = (VariableDefinition *)def;
+  if (vdef->mutated || vdef->value == NULL) return this;
+
+  long long i;
+  string s;
+  if (vdef->value->const_int(i)) return makeInt(i);
+  if (vdef->value->const_str(s)) return makeString(s);
+  return this;
+}
+
+bool NSlice::const_bounds(long long length, long long &from, long long &to) {
+  from = 0;
+  to = length;
+  if ((start && ! start->const_int(from)) || (stop && ! stop->const_int(to))) {
+    return false;
+  }
+  // As Python does it - negative counts back from the end, and anything
+  // past either end is clamped to it
+  if (from < 0) from += length;
+  if (to < 0) to += length;
+  from = std::min(std::max(from, 0LL), length);
+  to = std::min(std::max(to, from), length);
+  return true;
+}
+
+bool NSlice::const_str(string &value) {
+  string s;
+  long long from, to;
+  if ( ! list_expr->const_str(s) || ! const_bounds(s.length(), from, to)) {
+    return false;
+  }
+  value = s.substr(from, to - from);
+  return true;
+}
+
+bool NSlice::const_len(long long &length) {
+  long long from, to;
+  if ( ! list_expr->const_len(length) || ! const_bounds(length, from, to)) {
+    return false;
+  }
+  length = to - from;
+  return true;
+}
+
+NExpression *NSlice::fold() {
+  list_expr = list_expr->fold();
+  if (start) start = start->fold();
+  if (stop) stop = stop->fold();
+
+  string value;
+  return const_str(value) ? makeString(value) : this;
+}
+
+bool NIdentifier::const_len(long long &length) {
+  // Never changed, so it's as long as what it started as
+  Definition *def = resolve();
+  if (def == NULL || ! def->isVariable()) return false;
+  VariableDefinition *vdef = (VariableDefinition *)def;
+  return ! vdef->mutated && vdef->value && vdef->value->const_len(length);
+}
+
+NExpression *NIdentifier::const_item(long long i) {
+  Definition *def = resolve();
+  if (def == NULL || ! def->isVariable()) return NULL;
+  VariableDefinition *vdef = (VariableDefinition *)def;
+  return vdef->mutated || vdef->value == NULL ? NULL : vdef->value->const_item(i);
+}
+
+void NExpressionArgs::fold() {
+  for (NExpression *&expr : exprs) {
+    expr = expr->fold();
+  }
+  for (NKeywordArg *arg : keywords) {
+    arg->value = arg->value->fold();
+  }
+}
+
+NExpression *NList::fold() {
+  contents->fold();
+  return this;
+}
+
+bool NList::const_len(long long &length) {
+  // Anything in it still has to be run
+  if ( ! is_constant()) return false;
+  length = contents->size();
+  return true;
+}
+
+NExpression *NList::const_item(long long i) {
+  if ( ! is_constant() || i < 0 || i >= (long long)contents->size()) return NULL;
+  return (*contents)[i];
+}
+
+NExpression *NListIndex::fold() {
+  list_expr = list_expr->fold();
+  index = index->fold();
+
+  // xs[-1] of something with a known length counts from the front instead
+  long long i, length;
+  if (index->const_int(i) && i < 0 && list_expr->const_len(length)
+      && i >= -length) {
+    index = makeInt(i + length);
+  }
+  return this;
+}
+
+NExpression *NFunctionCallExpression::fold() {
+  args->fold();
+  NExpression *value = definition->foldCall(args);
+  return value ? value : this;
+}
+
+NStatement *NBlock::fold() {
+  for (NStatement *&stmt : stmts) {
+    stmt = stmt->fold();
+  }
+  return this;
+}
+
+NStatement *NExpressionStatement::fold() {
+  expr = expr->fold();
+  return this;
+}
+
+NStatement *NAssignment::fold() {
+  Definition *def = lhs->resolve();
+  VariableDefinition *vdef = (VariableDefinition *)def;
+  bool defines = def->isVariable() && vdef->value == rhs;
+  rhs = rhs->fold();
+  // Uses further on pick the folded value up from here
+  if (defines) vdef->value = rhs;
+  if (inPlace) inPlace->fold();
+  return this;
+}
+
+NStatement *NAugAssignment::fold() {
+  rhs = rhs->fold();
+  return this;
+}
+
+NStatement *NWhileStatement::fold() {
+  expr = expr->fold();
+  stmt = stmt->fold();
+
+  long long value;
+  if (expr->const_int(value) && value == 0) {
+    return Context::current()->make<NPassStatement>();
+  }
+  return this;
+}
+
+NStatement *NForStatement::fold() {
+  iterable = iterable->fold();
+  stmt = stmt->fold();
+  return this;
+}
+
+/*
+ * Folds an elif chain in place
+ * An elif that can't run is skipped over, and one that always runs becomes
+ * the else - the rest of the chain can't be reached.
+ */
+static void foldElifs(NElifStatement *&elifStmt, NElseStatement *&elseStmt) {
+  Context *ctx = Context::current();
+  while (elifStmt) {
+    elifStmt->expr = elifStmt->expr->fold();
+    elifStmt->stmt = elifStmt->stmt->fold();
+
+    long long value;
+    if ( ! elifStmt->expr->const_int(value)) {
+      foldElifs(elifStmt->elifStmt, elifStmt->elseStmt);
+      return;
+    }
+    if (value) {
+      elseStmt = ctx->make<NElseStatement>(elifStmt->stmt);
+      elifStmt = NULL;
+      return;
+    }
+    NElifStatement *skipped = elifStmt;
+    elifStmt = skipped->elifStmt;
+    elseStmt = skipped->elseStmt;
+  }
+  if (elseStmt) {
+    elseStmt->stmt = elseStmt->stmt->fold();
+  }
+}
+
+NStatement *NIfStatement::fold() {
+  Context *ctx = Context::current();
+  expr = expr->fold();
+  stmt = stmt->fold();
+  foldElifs(elifStmt, elseStmt);
+
+  long long value;
+  if ( ! expr->const_int(value)) return this;
+
+  // Only one branch can run, but its variables still stay inside it
+  if (value) {
+    return ctx->make<NCompoundStatement>(stmt);
+  }
+  if (elifStmt) {
+    // Already folded, and known not to be constant
+    return ctx->make<NIfStatement>(elifStmt->expr, elifStmt->stmt,
+                                   elifStmt->elifStmt, elifStmt->elseStmt);
+  }
+  if (elseStmt) {
+    return ctx->make<NCompoundStatement>(elseStmt->stmt);
+  }
+  return ctx->make<NPassStatement>();
+}
+
+void fold(Context *ctx) {
+  for (NStatement *&stmt : ctx->rootStmts) {
+    stmt = stmt->fold();
+  }
+  for (NFunctionDeclStatement *stmt : ctx->rootFuncStmts) {
+    stmt->fold();
+  }
+}
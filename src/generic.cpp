@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+
+#include "node.hpp"
+#include "scope.hpp"
+
+// extract() is in javelin.y, where the token kinds are known
+
+FunctionDefinition *GenericFunctionDefinition::specialize(NExpressionArgs *args) {
+  if (args->size() != params) return this;
+
+  std::vector<Type *> types;
+  for (NExpression *expr : args->exprs) {
+    Type *type = expr->get_type();
+    if (type->isUnset()) {
+      throw std::runtime_error("Can't tell which " + name + "() to call");
+    }
+    types.push_back(type);
+  }
+  for (auto &version : versions) {
+    if (version.first == types) return version.second;
+  }
+
+  // Picked up by the function declared first, which adds itself to versions
+  Context *ctx = Context::current();
+  ctx->specializing = this;
+  ctx->specializingTypes = types;
+  try {
+    parse_more(ctx, tokens, scope);
+  } catch (const std::runtime_error &error) {
+    ctx->specializing = NULL;
+    string signature;
+    for (Type *type : types) {
+      if ( ! signature.empty()) signature += ", ";
+      signature += type->cpp_type_string();
+    }
+    throw std::runtime_error(string(error.what()) + ", in the " + name + "("
+                             + signature + ") called");
+  }
+  ctx->specializing = NULL;
+
+  // Calls on the way may have added versions of their own
+  for (size_t i = 0; i < versions.size(); i++) {
+    if (versions[i].first != types) continue;
+
+    // Overloads would be ambiguous for braced lists, so the rest get names
+    // of their own
+    NFunctionDeclStatement *stmt = versions[i].second->stmt;
+    if (i > 0) {
+      stmt->id = ctx->make<NIdentifier>("javelin_" + name + "_"
+                                        + std::to_string(i + 1));
+    }
+    return versions[i].second;
+  }
+  throw std::runtime_error(name + " is not a function");
+}
+
+Type* GenericFunctionDefinition::get_type() {
+  return Context::current()->types.get_unset();
+}
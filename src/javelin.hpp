@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace javelin {
+  // The outcome of transpiling one Python source
+  struct Result {
+    bool success;
+    // The generated C++, on success
+    std::string output;
+    // What went wrong, and where, on failure
+    std::string error;
+    int line;
+    // Memory the transpile held at its peak, all of it released on return
+    size_t peakBytes;
+  };
+
+  // Optional extras for a transpile
+  struct Options {
+    // Keep the results of every pure recursive function, not just the
+    // ones marked @cache
+    bool memoize;
+    // Check every index that isn't known to be in range, raising an
+    // IndexError like Python does - rather than reading past the end
+    bool checkIndices;
+
+    Options() : memoize(false), checkIndices(true) {}
+  };
+
+  // Transpiles Python3 source to C++. Safe to call from several threads.
+  Result transpile(const std::string &source,
+                   const Options &options = Options());
+}
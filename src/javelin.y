@@ -1,19 +1,30 @@
 %{
+#include <algorithm>
 #include <string>
 #include <stdexcept>
 #include <stdio.h>
 #include "../src/type.hpp"
 #include "../src/node.hpp"
 #include "../src/scope.hpp"
-    std::vector<NStatement*> rootStmts; // Main program blocks
-    std::vector<NFunctionDeclStatement*> rootFuncStmts;
-    std::vector<NAssignment*> rootAssignStmts;
-    void yyerror(char const *);
-    extern int yylex(void);
-    FunctionScope *beginFunctionScope;
-    FunctionStack *lastFuncStack;
+#include "../src/context.hpp"
+#include "../src/javelin.hpp"
+#include "../src/passes.hpp"
 %}
 
+%code requires {
+  typedef void* yyscan_t;
+}
+
+%code {
+  void yyerror(Context *ctx, yyscan_t scanner, char const *);
+  extern int yylex(YYSTYPE *lvalp, yyscan_t scanner);
+  static std::vector<Token> lex(yyscan_t scanner);
+}
+
+%define api.pure full
+%parse-param {Context *ctx} {yyscan_t scanner}
+%lex-param {yyscan_t scanner}
+
 %error-verbose
 
 %union {
@@ -29,45 +40,58 @@
   NString *str_val;
   NIdentifier *id_val;
   NArgs *args;
+  NArg *arg;
   NExpressionArgs *exprags;
+  NKeywordArg *kwarg;
+  NOpType op;
   Type *type;
   std::string *str;
 }
 
-%token EOL
-%token '=' '+' '-' '/' '*' '%' ':' ',' '{' '}' '[' ']'
+%token EOL INDENT DEDENT
+%token '=' '+' '-' '/' '*' '%' ':' ',' '[' ']' '@'
 %token FOR IN WHILE IF ELSE ELIF RETURN PASS CONTINUE BREAK
 %token <str_val> STRING
 %token <int_val> INTEGER
 %token <id_val> ID
 %token LT NOT LTE GT GTE EQ NEQ AND OR SL SR BA BO BN BX
 %token DEF RTYPE
+%token <op> AUG_ASSIGN
 
 %type <type> rtype
-%type <stmt> stmt assign block while if
+%type <stmt> stmt assign aug_assign block while if
 %type <for_stmt> for for_header
 %type <elif_stmt> elif
 %type <else_stmt> else
 %type <block_p> block_p
 %type <expr> expr function_call list_expr
-%type <stmt> def ret
-%type <funcDeclStmt> funcDef
+%type <stmt> ret
+%type <funcDeclStmt> def funcDef
 %type <args> args arg_list
+%type <arg> arg
 %type <type> type // ROFLCOPTERLMFGSDAO
-%type <exprags> args2 arg_list2
+%type <exprags> args2 arg_list2 call_args kwarg_list
+%type <kwarg> kwarg
 
 // For future reference regarding precedence:
 // https://docs.python.org/3.6/reference/expressions.html
 // http://stackoverflow.com/questions/16679272/
 
-%left AND
+// Loosest first, as in python - constant folding works straight off the tree
 %left OR
+%left AND
 %left NOT
 %left LT LTE GT GTE EQ NEQ
 %precedence '('
 
+%left BO
+%left BX
+%left BA
+%left SL SR
 %left '+' '-'
 %left '*' '/' '%'
+%precedence UNARY
+%precedence '['
 
 /*
  *Grammar rules and actions
@@ -78,191 +102,439 @@ program: /* empty */
 ;
 
 stmt: assign EOL { $$ = $1; }
+    | aug_assign EOL { $$ = $1; }
     | while { $$ = $1; }
     | for { $$ = $1; }
     | if { $$ = $1; }
     | def { $$ = $1; }
     | ret { $$ = $1; }
-    | function_call EOL { $$ = new NExpressionStatement($1); }
-    | PASS EOL { $$ = new NPassStatement(); }
-    | BREAK EOL { $$ = new NBreakStatement(); }
-    | CONTINUE EOL { $$ = new NContinueStatement(); }
+    | function_call EOL { $$ = ctx->make<NExpressionStatement>($1); }
+    | PASS EOL { $$ = ctx->make<NPassStatement>(); }
+    | BREAK EOL { $$ = ctx->make<NBreakStatement>(); }
+    | CONTINUE EOL { $$ = ctx->make<NContinueStatement>(); }
 ;
 
-block: '{' EOL block_p_start block_p '}' EOL {
+block: EOL INDENT block_p_start block_p DEDENT {
   $$ = $4;
 
   // Note: Don't deallocate the scope yet, just in case a block latched on
-  currentScope = currentScope->next;
+  ctx->currentScope = ctx->currentScope->next;
 
   // Pop off the function stack, as appropriate
-  int depth = currentScope->depth();
-  if (funcStack && funcStack->level >= depth) {
+  int depth = ctx->currentScope->depth();
+  if (ctx->funcStack && ctx->funcStack->level >= depth) {
     // Keep this fellow around for type implications
-    lastFuncStack = funcStack;
-    funcStack = lastFuncStack->parent;
+    ctx->lastFuncStack = ctx->funcStack;
+    ctx->funcStack = ctx->lastFuncStack->parent;
   }
 }
 ;
 
 // This exists soley to push a new scope, it doesn't match anything
 block_p_start: /* empty */ {
-  if (beginFunctionScope != NULL) {
-    currentScope = beginFunctionScope;
-    beginFunctionScope = NULL;
+  if (ctx->beginFunctionScope != NULL) {
+    ctx->currentScope = ctx->beginFunctionScope;
+    ctx->beginFunctionScope = NULL;
   } else {
-    currentScope = new Scope(currentScope);
+    ctx->currentScope = ctx->make<Scope>(ctx->currentScope);
   }
 };
 
-block_p: stmt block_p { $$ = new NBlock($1, $2); }
-    | stmt { $$ = new NBlock($1, NULL); }
+// Left recursive, so a long block doesn't pile up on the parser stack
+block_p: stmt { $$ = ctx->make<NBlock>(); $$->add($1); }
+    | block_p stmt { $$ = $1; $$->add($2); }
 ;
 
 expr: function_call { $$ = $1; }
-    | expr '[' expr ']' { $$ = new NListIndex($1, $3); }
+    | expr '[' expr ']' { $$ = ctx->make<NListIndex>($1, $3); }
+    | expr '[' expr ':' expr ']' { $$ = ctx->make<NSlice>($1, $3, $5); }
+    | expr '[' ':' expr ']' { $$ = ctx->make<NSlice>($1, nullptr, $4); }
+    | expr '[' expr ':' ']' { $$ = ctx->make<NSlice>($1, $3, nullptr); }
+    | expr '[' ':' ']' { $$ = ctx->make<NSlice>($1, nullptr, nullptr); }
     | '(' expr ')' { $$ = $2; }
     | INTEGER { $$ = $1; }
-    | ID { $$ = $1; }
+    | ID { $$ = $1; $1->markRead(); }
     | STRING { $$ = $1; }
     | list_expr { $$ = $1; }
-    | expr LT  expr { $$ = new NBinaryOperator($1, N_LT, $3); }
-    | expr LTE expr { $$ = new NBinaryOperator($1, N_LTE, $3); }
-    | expr GT  expr { $$ = new NBinaryOperator($1, N_GT, $3); }
-    | expr GTE expr { $$ = new NBinaryOperator($1, N_GTE, $3); }
-    | expr NEQ expr { $$ = new NBinaryOperator($1, N_NEQ, $3); }
-    | expr EQ  expr { $$ = new NBinaryOperator($1, N_EQ, $3); }
-    | expr AND expr { $$ = new NBinaryOperator($1, N_AND, $3); }
-    | expr OR  expr { $$ = new NBinaryOperator($1, N_OR, $3); }
-    | expr SL  expr { $$ = new NBinaryOperator($1, N_SL, $3); }
-    | expr SR  expr { $$ = new NBinaryOperator($1, N_SR, $3); }
-    | expr BA  expr { $$ = new NBinaryOperator($1, N_BA, $3); }
-    | expr BO  expr { $$ = new NBinaryOperator($1, N_BO, $3); }
-    | expr BX  expr { $$ = new NBinaryOperator($1, N_BX, $3); }
-    | NOT expr      { $$ = new NUnaryOperator(N_NOT, $2); }
-    | BN expr       { $$ = new NUnaryOperator(N_BN, $2); }
-    | '-' expr      { $$ = new NUnaryOperator(N_SUB, $2); }
-    | expr '+' expr { $$ = new NBinaryOperator($1, N_ADD, $3); }
-    | expr '-' expr { $$ = new NBinaryOperator($1, N_SUB, $3); }
-    | expr '*' expr { $$ = new NBinaryOperator($1, N_MUL, $3); }
-    | expr '/' expr { $$ = new NBinaryOperator($1, N_DIV, $3); }
+    | expr LT  expr { $$ = ctx->make<NBinaryOperator>($1, N_LT, $3); }
+    | expr LTE expr { $$ = ctx->make<NBinaryOperator>($1, N_LTE, $3); }
+    | expr GT  expr { $$ = ctx->make<NBinaryOperator>($1, N_GT, $3); }
+    | expr GTE expr { $$ = ctx->make<NBinaryOperator>($1, N_GTE, $3); }
+    | expr NEQ expr { $$ = ctx->make<NBinaryOperator>($1, N_NEQ, $3); }
+    | expr EQ  expr { $$ = ctx->make<NBinaryOperator>($1, N_EQ, $3); }
+    | expr AND expr { $$ = ctx->make<NBinaryOperator>($1, N_AND, $3); }
+    | expr OR  expr { $$ = ctx->make<NBinaryOperator>($1, N_OR, $3); }
+    | expr SL  expr { $$ = ctx->make<NBinaryOperator>($1, N_SL, $3); }
+    | expr SR  expr { $$ = ctx->make<NBinaryOperator>($1, N_SR, $3); }
+    | expr BA  expr { $$ = ctx->make<NBinaryOperator>($1, N_BA, $3); }
+    | expr BO  expr { $$ = ctx->make<NBinaryOperator>($1, N_BO, $3); }
+    | expr BX  expr { $$ = ctx->make<NBinaryOperator>($1, N_BX, $3); }
+    | NOT expr      { $$ = ctx->make<NUnaryOperator>(N_NOT, $2); }
+    | BN expr %prec UNARY  { $$ = ctx->make<NUnaryOperator>(N_BN, $2); }
+    | '-' expr %prec UNARY { $$ = ctx->make<NUnaryOperator>(N_SUB, $2); }
+    | expr '+' expr { $$ = ctx->make<NBinaryOperator>($1, N_ADD, $3); }
+    | expr '-' expr { $$ = ctx->make<NBinaryOperator>($1, N_SUB, $3); }
+    | expr '*' expr { $$ = ctx->make<NBinaryOperator>($1, N_MUL, $3); }
+    | expr '/' expr { $$ = ctx->make<NBinaryOperator>($1, N_DIV, $3); }
     | expr '%' expr {
       // Since modulus is different in C++ than in Python
-      $$ = new NFunctionCallExpression(new NIdentifier("javelin::modulus"),
-          new NExpressionArgs($1, new NExpressionArgs($3, NULL)));
+      NExpressionArgs *args = ctx->make<NExpressionArgs>();
+      args->add($1);
+      args->add($3);
+      $$ = ctx->make<NFunctionCallExpression>(
+          ctx->make<NIdentifier>("javelin::modulus"), args);
     }
 ;
 
 list_expr: '[' args2 ']' {
-  $$ = new NList($2);
+  $$ = ctx->make<NList>($2);
 };
 
-ret: RETURN expr EOL { $$ = new NReturn($2); }
-   | RETURN EOL { $$ = new NReturn(NULL); };
+ret: RETURN expr EOL { $$ = ctx->make<NReturn>($2); }
+   | RETURN EOL { $$ = ctx->make<NReturn>(nullptr); };
 
-assign: ID '=' expr { $$ = new NAssignment($1, $3); }
+assign: ID '=' expr { $$ = ctx->make<NAssignment>($1, $3); }
 ;
 
-while: WHILE expr ':' block { $$ = new NWhileStatement($2, $4); }
+aug_assign: ID AUG_ASSIGN expr { $$ = ctx->make<NAugAssignment>($1, $2, $3); }
+;
+
+while: WHILE expr ':' block { $$ = ctx->make<NWhileStatement>($2, $4); }
 ;
 
 for: for_header block { $$ = $1; $$->stmt = $2; } ;
-for_header: FOR ID IN expr ':' { $$ = new NForStatement($2, $4, NULL); };
+for_header: FOR ID IN expr ':' { $$ = ctx->make<NForStatement>($2, $4, nullptr); };
 
-if: IF expr ':' block        { $$ = new NIfStatement($2, $4, NULL, NULL); }
-    | IF expr ':' block elif { $$ = new NIfStatement($2, $4, $5, NULL); }
-    | IF expr ':' block else { $$ = new NIfStatement($2, $4, NULL, $5); }
+if: IF expr ':' block        { $$ = ctx->make<NIfStatement>($2, $4, nullptr, nullptr); }
+    | IF expr ':' block elif { $$ = ctx->make<NIfStatement>($2, $4, $5, nullptr); }
+    | IF expr ':' block else { $$ = ctx->make<NIfStatement>($2, $4, nullptr, $5); }
 ;
 
-elif: ELIF expr ':' block      { $$ = new NElifStatement($2, $4, NULL, NULL); }
-    | ELIF expr ':' block elif { $$ = new NElifStatement($2, $4, $5, NULL); }
-    | ELIF expr ':' block else { $$ = new NElifStatement($2, $4, NULL, $5); }
+elif: ELIF expr ':' block      { $$ = ctx->make<NElifStatement>($2, $4, nullptr, nullptr); }
+    | ELIF expr ':' block elif { $$ = ctx->make<NElifStatement>($2, $4, $5, nullptr); }
+    | ELIF expr ':' block else { $$ = ctx->make<NElifStatement>($2, $4, nullptr, $5); }
 ;
 
-else: ELSE ':' block { $$ = new NElseStatement($3); }
+else: ELSE ':' block { $$ = ctx->make<NElseStatement>($3); }
 ;
 
 def: DEF funcDef block {
   $2->stmt = $3;
   // In case the type has been implied
-  Type *type = lastFuncStack->get_type();
-  $2->type = type->isUnset() ? new VoidType() : type;
+  Type *type = ctx->lastFuncStack->get_type();
+  $2->type = type->isUnset() ? ctx->types.get_void() : type;
+  // Only root functions get versions, so the body has to imply the rest
+  for (NArg *arg : $2->args->args) {
+    if (arg->type->isUnset()) {
+      throw std::runtime_error($2->id->name + "() isn't a root function, so "
+                               + arg->id->name + " needs a type");
+    }
+  }
   $$ = $2;
-};
+}
+   | '@' ID EOL def { $$ = $4; $$->decorate($2); }
+;
 // So we can define a function before evaluating the content (allow recursion)
 funcDef: ID '(' args ')' rtype ':' {
-    $$ = new NFunctionDeclStatement($1, $3, $5, NULL);
-    funcStack->stmt = $$;
-    beginFunctionScope = new FunctionScope(currentScope, $$);
+    $$ = ctx->make<NFunctionDeclStatement>($1, $3, $5, nullptr);
+    ctx->funcStack->stmt = $$;
+    ctx->beginFunctionScope = ctx->make<FunctionScope>(ctx->currentScope, $$);
 };
-args: /* empty */ { $$ = NULL; }
+args: /* empty */ { $$ = ctx->make<NArgs>(); }
     | arg_list { $$ = $1; }
 ;
-arg_list:
-      ID ':' type { $$ = new NArgs($1, $3, NULL); }
-    | ID ':' type ',' arg_list { $$ = new NArgs($1, $3, $5); }
-    | ID { $$ = new NArgs($1, new UnsetType(), NULL); }
-    | ID ',' arg_list { $$ = new NArgs($1, new UnsetType(), $3); }
+arg_list: arg { $$ = ctx->make<NArgs>(); $$->add($1); }
+    | arg_list ',' arg { $$ = $1; $$->add($3); }
+;
+arg: ID ':' type { $$ = ctx->make<NArg>($1, $3); }
+    | ID { $$ = ctx->make<NArg>($1, ctx->types.get_unset()); }
 ;
 
 // Pushes the function type to the stack here, so we know what returns should be
 rtype: /* empty */ {
-  $$ = new UnsetType();
-  funcStack = new FunctionStack(currentScope->depth(), funcStack, $$);
+  $$ = ctx->types.get_unset();
+  ctx->funcStack = ctx->make<FunctionStack>(ctx->currentScope->depth(),
+                                    ctx->funcStack, $$);
 } | RTYPE type {
   $$ = $2;
-  funcStack = new FunctionStack(currentScope->depth(), funcStack, $$);
+  ctx->funcStack = ctx->make<FunctionStack>(ctx->currentScope->depth(),
+                                    ctx->funcStack, $$);
 };
 
-args2: /* empty */ { $$ = NULL; }
+args2: /* empty */ { $$ = ctx->make<NExpressionArgs>(); }
     | arg_list2 { $$ = $1; }
 ;
-arg_list2: expr { $$ = new NExpressionArgs($1, NULL); }
-    | expr ',' arg_list2 { $$ = new NExpressionArgs($1, $3); }
+arg_list2: expr { $$ = ctx->make<NExpressionArgs>(); $$->add($1); }
+    | arg_list2 ',' expr { $$ = $1; $$->add($3); }
+;
+
+// Keyword arguments go last, as in python
+call_args: args2 { $$ = $1; }
+    | kwarg_list { $$ = $1; }
+    | arg_list2 ',' kwarg_list {
+      $$ = $1;
+      for (NKeywordArg *arg : $3->keywords) $$->addKeyword(arg);
+    }
+;
+kwarg_list: kwarg { $$ = ctx->make<NExpressionArgs>(); $$->addKeyword($1); }
+    | kwarg_list ',' kwarg { $$ = $1; $$->addKeyword($3); }
+;
+kwarg: ID '=' expr { $$ = ctx->make<NKeywordArg>($1, $3); }
 ;
 
-function_call: ID '(' args2 ')' { $$ = new NFunctionCallExpression($1, $3); }
+function_call: ID '(' call_args ')' { $$ = ctx->make<NFunctionCallExpression>($1, $3); }
 ;
 
 // In the future, this should check the symbol table
-type: ID {if ($1->name == "str") $$ =  new StringType();
-          else $$ = new BasicType($1->name);}
+type: ID {if ($1->name == "str") $$ = ctx->types.get_string();
+          else $$ = ctx->types.get_basic($1->name);}
 %%
 
 #include "../obj/javelin.yy.c"
-int main() {
-  try {
-    currentScope = new RootScope();
-    funcStack = NULL;
-
-    yyin = stdin;
-    yyparse();
 
-    // One header to rule them all
-    cout << "#include \"inc/javelin.h\"\n";
+namespace javelin {
+  Result transpile(const std::string &source, const Options &options) {
+    Context ctx;
+    Emitter code;
+    Result result;
+    yyscan_t scanner;
+
+    yylex_init_extra(&ctx, &scanner);
+    YY_BUFFER_STATE buffer = NULL;
+
+    ctx.options = options;
+    try {
+      ctx.currentScope = ctx.make<RootScope>();
+
+      buffer = yy_scan_bytes(source.data(), source.size(), scanner);
+      std::vector<Token> tokens = lex(scanner);
+
+      // Functions with untyped parameters only get parsed once called
+      GenericFunctionDefinition::extract(ctx.currentScope, tokens);
+      ctx.tokens = &tokens;
+
+      if (yyparse(&ctx, scanner) == 0) {
+        typecheck(&ctx);
+        fold(&ctx);
+        eliminate_tail_calls(&ctx);
+        bound_counters(&ctx);
+        analyse_functions(&ctx);
+        eliminate_dead_code(&ctx);
+        optimise_loops(&ctx);
+
+        // Generate the headers first, so we don't run into annoying mutuality conflicts
+        Emitter body;
+        for (NFunctionDeclStatement *stmt : ctx.rootFuncStmts) {
+          stmt->generateHeader(body);
+        }
+        // constexpr ones go before main(), so calls there can be worked out
+        for (NFunctionDeclStatement *stmt : ctx.rootFuncStmts) {
+          if (stmt->constexprValue) stmt->generate(body);
+        }
+
+        body << "int main() {\n";
+        body.indent();
+        for (NStatement *stmt : ctx.rootStmts) {
+          stmt->generate(body);
+        }
+        body.dedent();
+        body << "}\n";
+        for (NFunctionDeclStatement *stmt : ctx.rootFuncStmts) {
+          if ( ! stmt->constexprValue) stmt->generate(body);
+        }
+
+        // One header to rule them all
+        code << "#include \"inc/javelin.h\"\n";
+
+        // Only now is it known which literals are left after folding
+        for (size_t i = 0; i < ctx.literals.size(); i++) {
+          if ( ! ctx.literals.isUsed(i)) continue;
+          code << "static const std::string javelin_literal_" << (int)i
+               << " = \"" << ctx.literals.value(i) << "\";\n";
+        }
+        code << body.str();
+
+        // All root function & class declarations should be before main().
+      }
+    } catch (const std::runtime_error& error) {
+      yyerror(&ctx, scanner, error.what());
+    }
 
-    // Generate the headers first, so we don't run into annoying mutuality conflicts
-    for (NFunctionDeclStatement *stmt : rootFuncStmts) {
-      stmt->generateHeader();
+    result.success = ctx.error.empty();
+    result.line = result.success ? 0 : yyget_lineno(scanner);
+    result.error = ctx.error;
+    result.peakBytes = ctx.arena.peak_bytes();
+    if (result.success) {
+      result.output = code.str();
     }
 
-    cout << "int main() {\n";
-    for (NStatement *stmt : rootStmts) {
-      stmt->generate(1);
+    if (buffer) yy_delete_buffer(buffer, scanner);
+    yylex_destroy(scanner);
+    return result;
+  }
+}
+
+// Reads all the tokens in the scanner's buffer
+static std::vector<Token> lex(yyscan_t scanner) {
+  std::vector<Token> tokens;
+  while (true) {
+    Token token;
+    token.kind = javelin_lex(&token, scanner);
+    if (token.kind == 0) return tokens;
+    token.line = yyget_lineno(scanner);
+    tokens.push_back(token);
+  }
+}
+
+// Hands the parser its next token, making a fresh value for it
+int yylex(YYSTYPE *lvalp, yyscan_t scanner) {
+  Context *ctx = yyget_extra(scanner);
+  if (ctx->nextToken == ctx->tokens->size()) return 0;
+
+  const Token &token = (*ctx->tokens)[ctx->nextToken++];
+  yyset_lineno(token.line, scanner);
+  switch (token.kind) {
+    case ID: lvalp->id_val = ctx->make<NIdentifier>(token.text); break;
+    case INTEGER: lvalp->int_val = ctx->make<NInteger>(token.value); break;
+    case STRING: lvalp->str_val = ctx->make<NString>(token.text); break;
+    case AUG_ASSIGN: lvalp->op = (NOpType)token.value; break;
+  }
+  return token.kind;
+}
+
+/*
+ * Whether the def at tokens[start], or the decorators in front of it, has a
+ * parameter with no type. If so, its name, how many parameters it has, and
+ * where its block ends.
+ */
+static bool is_generic(const std::vector<Token> &tokens, size_t start,
+                       string &name, size_t &params, size_t &end) {
+  size_t i = start;
+  while (i + 2 < tokens.size() && tokens[i].kind == '@'
+         && tokens[i + 1].kind == ID && tokens[i + 2].kind == EOL) {
+    i += 3;
+  }
+  if (i + 2 >= tokens.size() || tokens[i].kind != DEF
+      || tokens[i + 1].kind != ID || tokens[i + 2].kind != '(') {
+    return false;
+  }
+  name = tokens[i + 1].text;
+
+  // A parameter that's only a name has no type
+  params = 0;
+  bool untyped = false;
+  size_t length = 0;
+  for (i += 3; i < tokens.size() && tokens[i].kind != EOL; i++) {
+    if (tokens[i].kind != ',' && tokens[i].kind != ')') {
+      length++;
+      continue;
     }
-    cout << "}\n";
-    for (NFunctionDeclStatement *stmt : rootFuncStmts) {
-      stmt->generate(0);
+    if (length > 0) params++;
+    if (length == 1) untyped = true;
+    length = 0;
+    if (tokens[i].kind == ')') break;
+  }
+  if ( ! untyped) return false;
+
+  // The rest of the line, then the block, if it has one
+  while (i < tokens.size() && tokens[i].kind != EOL) i++;
+  end = i + 1;
+  if (end >= tokens.size() || tokens[end].kind != INDENT) return true;
+  int depth = 0;
+  for (; end < tokens.size(); end++) {
+    if (tokens[end].kind == INDENT) depth++;
+    if (tokens[end].kind == DEDENT && --depth == 0) break;
+  }
+  end++;
+  return true;
+}
+
+void GenericFunctionDefinition::extract(Scope *scope, std::vector<Token> &tokens) {
+  Context *ctx = Context::current();
+  std::vector<Token> left;
+  int depth = 0;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    // Only root statements, so only at the start of an unindented line
+    bool starts = i == 0 || tokens[i - 1].kind == EOL
+                  || tokens[i - 1].kind == DEDENT;
+    string name;
+    size_t params, end;
+    if (depth == 0 && starts && is_generic(tokens, i, name, params, end)) {
+      end = std::min(end, tokens.size());
+      std::vector<Token> span(tokens.begin() + i, tokens.begin() + end);
+      scope->addDefinition(name, ctx->make<GenericFunctionDefinition>(
+          name, std::move(span), params, scope));
+      i = end - 1;
+      continue;
     }
 
-    // All root function & class declarations should be before main().
-    return 0;
-  } catch (const std::runtime_error& error) {
-    yyerror(error.what());
+    if (tokens[i].kind == INDENT) depth++;
+    if (tokens[i].kind == DEDENT) depth--;
+    left.push_back(tokens[i]);
+  }
+  tokens.swap(left);
+}
+
+// What the parser keeps in the context as it goes
+struct ParseState {
+  Scope *currentScope;
+  FunctionStack *funcStack;
+  FunctionScope *beginFunctionScope;
+  FunctionStack *lastFuncStack;
+  const std::vector<Token> *tokens;
+  size_t nextToken;
+  std::string error;
+
+  ParseState(Context *ctx)
+    : currentScope(ctx->currentScope), funcStack(ctx->funcStack),
+      beginFunctionScope(ctx->beginFunctionScope),
+      lastFuncStack(ctx->lastFuncStack), tokens(ctx->tokens),
+      nextToken(ctx->nextToken), error(ctx->error) {}
+
+  void restore(Context *ctx) {
+    ctx->currentScope = currentScope;
+    ctx->funcStack = funcStack;
+    ctx->beginFunctionScope = beginFunctionScope;
+    ctx->lastFuncStack = lastFuncStack;
+    ctx->tokens = tokens;
+    ctx->nextToken = nextToken;
+    ctx->error = error;
+  }
+};
+
+void parse_more(Context *ctx, const std::vector<Token> &tokens, Scope *scope) {
+  // Whatever was being parsed picks up where it left off afterwards
+  ParseState saved(ctx);
+  ctx->currentScope = scope;
+  ctx->funcStack = NULL;
+  ctx->beginFunctionScope = NULL;
+  ctx->lastFuncStack = NULL;
+  ctx->tokens = &tokens;
+  ctx->nextToken = 0;
+  ctx->error.clear();
+
+  // Only for the line numbers - the tokens come from the context
+  yyscan_t scanner;
+  yylex_init_extra(ctx, &scanner);
+
+  std::string error;
+  try {
+    if (yyparse(ctx, scanner) != 0) error = ctx->error;
+  } catch (const std::runtime_error &e) {
+    error = e.what();
   }
+  if ( ! error.empty()) {
+    error += " on line " + std::to_string(yyget_lineno(scanner));
+  }
+  yylex_destroy(scanner);
+
+  saved.restore(ctx);
+  if ( ! error.empty()) throw std::runtime_error(error);
 }
 
-void yyerror(char const *m) {
-    fprintf(stderr, "Parse error: %s on line %d\n", m, yylineno);
-    exit(1);
+void yyerror(Context *ctx, yyscan_t scanner, char const *m) {
+  // Only the first error is worth reporting
+  if (ctx->error.empty()) {
+    ctx->error = m;
+  }
 }
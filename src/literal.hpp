@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Every distinct string literal in the program
+ * Each one still in use after folding becomes a single constant at the top
+ * of the generated file, so using it never builds (or frees) a string.
+ */
+class LiteralTable {
+  std::unordered_map<std::string, int> literals;
+  // Points at the keys above, in the order they were first seen
+  std::vector<const std::string *> values;
+  // Which ones the generated code refers to
+  std::vector<bool> used;
+
+public:
+  int intern(const std::string &value) {
+    auto itr = literals.find(value);
+    if (itr != literals.end()) {
+      return itr->second;
+    }
+    int literal = values.size();
+    values.push_back(&literals.emplace(value, literal).first->first);
+    used.push_back(false);
+    return literal;
+  }
+
+  void use(int literal) {
+    used[literal] = true;
+  }
+
+  bool isUsed(int literal) const {
+    return used[literal];
+  }
+
+  size_t size() const {
+    return values.size();
+  }
+
+  const std::string& value(int literal) const {
+    return *values[literal];
+  }
+};
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "node.hpp"
+#include "passes.hpp"
+
+// Whether anything in what it walks reads one of the given variables
+class ReadFinder : public NVisitor {
+public:
+  const std::vector<Definition *> &defs;
+  bool found;
+
+  ReadFinder(const std::vector<Definition *> &defs) : defs(defs), found(false) {}
+
+  virtual void visit(NExpression *expr) {
+    for (Definition *def : defs) {
+      if (expr->refersTo(def)) found = true;
+    }
+  }
+};
+
+/*
+ * What a loop stores to, and the invariants taken out of it
+ * Nothing but the loop itself can change its variables while it runs, so
+ * anything total that reads none of those comes out the same every time.
+ */
+class LoopInvariants : public NVisitor {
+public:
+  // Once for every store in the loop
+  std::vector<Definition *> stores;
+  std::vector<NHoisted *> &hoisted;
+  // Set while what's being looked at is sure to be worked out as the loop
+  // starts - so that working it out first changes nothing, total or not
+  bool entry;
+
+  LoopInvariants(NStatement *body, std::vector<NHoisted *> &hoisted)
+    : hoisted(hoisted), entry(false) {
+    body->walk(*this);
+  }
+
+  virtual void visit(NStatement *stmt) {
+    Definition *def = stmt->stored();
+    if (def) stores.push_back(def);
+  }
+
+  size_t storesTo(Definition *def) {
+    return std::count(stores.begin(), stores.end(), def);
+  }
+
+  // What to read instead of expr, if it can be worked out before the loop
+  NExpression *hoist(NExpression *expr) {
+    if ( ! expr->is_total() && ( ! entry || expr->has_side_effects())) {
+      return NULL;
+    }
+
+    ReadFinder finder(stores);
+    expr->walk(finder);
+    if (finder.found) return NULL;
+
+    NHoisted *value = Context::current()->make<NHoisted>(expr);
+    hoisted.push_back(value);
+    return value;
+  }
+};
+
+bool NBinaryOperator::is_total() {
+  switch (op) {
+  // Dividing by zero or shifting too far goes wrong
+  case N_DIV: case N_SL: case N_SR:
+    return false;
+  default:
+    return lhs->is_total() && rhs->is_total();
+  }
+}
+
+NExpression *NBinaryOperator::hoist_invariants(LoopInvariants &loop) {
+  // Only building a string is worth a temporary - the arithmetic is cheap
+  if (isStringConcat()) {
+    NExpression *value = loop.hoist(this);
+    if (value) return value;
+  }
+  lhs = lhs->hoist_invariants(loop);
+
+  // and/or might not get as far as the right hand side
+  bool entry = loop.entry;
+  if (op == N_AND || op == N_OR) loop.entry = false;
+  rhs = rhs->hoist_invariants(loop);
+  loop.entry = entry;
+  return this;
+}
+
+bool NExpressionArgs::is_total() {
+  for (NExpression *expr : exprs) {
+    if ( ! expr->is_total()) return false;
+  }
+  return keywords.empty();
+}
+
+void NExpressionArgs::hoist_invariants(LoopInvariants &loop) {
+  for (NExpression *&expr : exprs) {
+    expr = expr->hoist_invariants(loop);
+  }
+  for (NKeywordArg *arg : keywords) {
+    arg->value = arg->value->hoist_invariants(loop);
+  }
+}
+
+bool NFunctionCallExpression::is_total() {
+  return definition->isTotal() && args->is_total();
+}
+
+NExpression *NFunctionCallExpression::hoist_invariants(LoopInvariants &loop) {
+  NExpression *value = loop.hoist(this);
+  if (value) return value;
+  args->hoist_invariants(loop);
+  return this;
+}
+
+void NHoisted::generateDeclaration(Emitter &e) {
+  name = e.temp("inv");
+  e.line() << "const " << get_type()->cpp_type_string() << ' ' << name
+           << " = ";
+  expr->generate(e);
+  e << ";\n";
+}
+
+void NExpressionStatement::hoist_invariants(LoopInvariants &loop) {
+  expr = expr->hoist_invariants(loop);
+}
+
+Definition *NAssignment::stored() {
+  return lhs->resolve();
+}
+
+void NAssignment::hoist_invariants(LoopInvariants &loop) {
+  // Nothing to work out ahead for a store that isn't made
+  if ( ! generates()) return;
+  // Only the one of these gets generated
+  if (inPlace) {
+    inPlace->hoist_invariants(loop);
+  } else {
+    rhs = rhs->hoist_invariants(loop);
+  }
+}
+
+Definition *NAugAssignment::stored() {
+  return lhs->resolve();
+}
+
+void NAugAssignment::hoist_invariants(LoopInvariants &loop) {
+  if ( ! generates()) return;
+  rhs = rhs->hoist_invariants(loop);
+}
+
+bool NIfStatement::continues() {
+  return stmt->continues() || (elifStmt && elifStmt->continues())
+    || (elseStmt && elseStmt->continues());
+}
+
+void NIfStatement::hoist_invariants(LoopInvariants &loop) {
+  expr = expr->hoist_invariants(loop);
+  stmt->hoist_invariants(loop);
+  if (elifStmt) elifStmt->hoist_invariants(loop);
+  if (elseStmt) elseStmt->hoist_invariants(loop);
+}
+
+bool NElifStatement::continues() {
+  return stmt->continues() || (elifStmt && elifStmt->continues())
+    || (elseStmt && elseStmt->continues());
+}
+
+void NElifStatement::hoist_invariants(LoopInvariants &loop) {
+  expr = expr->hoist_invariants(loop);
+  stmt->hoist_invariants(loop);
+  if (elifStmt) elifStmt->hoist_invariants(loop);
+  if (elseStmt) elseStmt->hoist_invariants(loop);
+}
+
+void NWhileStatement::optimise_loop() {
+  LoopInvariants loop(stmt, hoisted);
+  loop.entry = true;
+  expr = expr->hoist_invariants(loop);
+  loop.entry = false;
+  stmt->hoist_invariants(loop);
+
+  /*
+   * while i < n: ... i += 1 is a counted loop, given that nothing else
+   * touches i, and no continue skips the update
+   */
+  NStatement *last = stmt->last();
+  NAugAssignment *update = last == stmt ? NULL : last->in_place();
+  long long by;
+  if (update == NULL || (update->op != N_ADD && update->op != N_SUB)
+      || update->lhs->get_type() != Context::current()->types.get_int()
+      || ! update->rhs->const_int(by)) {
+    return;
+  }
+
+  Definition *counter = update->lhs->resolve();
+  if (loop.storesTo(counter) != 1 || stmt->continues()) return;
+
+  std::vector<Definition *> counters(1, counter);
+  ReadFinder finder(counters);
+  expr->walk(finder);
+  if ( ! finder.found) return;
+
+  step = update;
+  stmt->drop_last();
+}
+
+void NWhileStatement::generate(Emitter &e) {
+  for (NHoisted *value : hoisted) {
+    value->generateDeclaration(e);
+  }
+
+  NStatement::generate(e);
+  if (step) {
+    long long by;
+    step->rhs->const_int(by);
+    if (step->op == N_SUB) by = -by;
+    const string &i = step->lhs->name;
+
+    e << "for (; ";
+    expr->generate(e);
+    e << "; ";
+    if (by == 1) {
+      e << i << "++";
+    } else if (by == -1) {
+      e << i << "--";
+    } else if (by >= 0) {
+      e << i << " += " << by;
+    } else {
+      e << i << " -= " << -by;
+    }
+    e << ") {\n";
+  } else {
+    e << "while (";
+    expr->generate(e);
+    e << ") {\n";
+  }
+  e.indent();
+  stmt->generate(e);
+  e.dedent();
+  e.line() << "}\n";
+}
+
+Definition *NForStatement::stored() {
+  return itr_name->resolve();
+}
+
+void NForStatement::optimise_loop() {
+  // Its own variable is stored to every time round, as well
+  LoopInvariants loop(this, hoisted);
+  stmt->hoist_invariants(loop);
+}
+
+void NForStatement::bound_counter() {
+  // A range() counts between its bounds, if nothing else moves the counter
+  // or what the stop was worked out from
+  std::vector<NHoisted *> unused;
+  LoopInvariants loop(this, unused);
+  long long from;
+  NExpression *below = iterable->counts_up(from);
+  VariableDefinition *counter = (VariableDefinition *)stored();
+  if (below == NULL || loop.storesTo(counter) != 1) return;
+
+  ReadFinder finder(loop.stores);
+  below->walk(finder);
+  if (finder.found) return;
+  counter->from = from;
+  counter->below = below;
+}
+
+void NForStatement::generate(Emitter &e) {
+  for (NHoisted *value : hoisted) {
+    value->generateDeclaration(e);
+  }
+
+  NStatement::generate(e);
+  iterable->generate_itr_header(e, itr_name);
+  e.indent();
+  stmt->generate(e);
+  e.dedent();
+  e.line() << "}\n";
+}
+
+// Handed every statement, so every loop - nested ones included
+class LoopOptimiser : public NVisitor {
+public:
+  virtual void visit(NStatement *stmt) {
+    stmt->optimise_loop();
+  }
+};
+
+void optimise_loops(Context *ctx) {
+  LoopOptimiser optimiser;
+  for (NStatement *stmt : ctx->rootStmts) {
+    stmt->walk(optimiser);
+  }
+  for (NFunctionDeclStatement *stmt : ctx->rootFuncStmts) {
+    stmt->walk(optimiser);
+  }
+}
+
+class CounterBounds : public NVisitor {
+public:
+  virtual void visit(NStatement *stmt) {
+    stmt->bound_counter();
+  }
+};
+
+void bound_counters(Context *ctx) {
+  CounterBounds bounds;
+  for (NStatement *stmt : ctx->rootStmts) {
+    stmt->walk(bounds);
+  }
+  for (NFunctionDeclStatement *stmt : ctx->rootFuncStmts) {
+    stmt->walk(bounds);
+  }
+}
@@ -0,0 +1,35 @@
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "javelin.hpp"
+
+int main(int argc, char **argv) {
+  javelin::Options options;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--memoize") {
+      options.memoize = true;
+    } else if (std::string(argv[i]) == "--unchecked") {
+      options.checkIndices = false;
+    } else {
+      fprintf(stderr, "Usage: %s [--memoize] [--unchecked] < source.py\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  std::string source((std::istreambuf_iterator<char>(std::cin)),
+                     std::istreambuf_iterator<char>());
+
+  javelin::Result result = javelin::transpile(source, options);
+  if ( ! result.success) {
+    fprintf(stderr, "Parse error: %s on line %d\n",
+            result.error.c_str(), result.line);
+    return 1;
+  }
+
+  // All of the generated code goes out in a single write
+  fwrite(result.output.data(), 1, result.output.size(), stdout);
+  return 0;
+}
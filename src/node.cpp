@@ -3,30 +3,119 @@
 #include "type.hpp"
 #include "node.hpp"
 
-void NExpression::generate_itr_header(NIdentifier *id) {
+// Opens a for loop over something with the given item type, up to the ':'
+static void generate_for_start(Emitter &e, Type *itr_type, NIdentifier *id) {
+  VariableDefinition *def = (VariableDefinition *)id->resolve();
+  e << "for (";
+  if (itr_type->isCheapToCopy() || def->mutated) {
+    e << itr_type->cpp_type_string();
+  } else {
+    // Nothing assigns to it, so there's no need for a copy of each element
+    e << "const auto&";
+  }
+  e << ' ' << id->name << " : ";
+}
+
+void NExpression::generate_itr_header(Emitter &e, NIdentifier *id) {
   Type *t = get_type();
-  if (t->isIndexible()) {
-    t = ((ListType *)t)->get_itr_type();
+  if (t == Context::current()->types.get_string()) {
+    // Walks the string in place, rather than making a string per character
+    // - unless the loop assigns to it, so it needs to be a whole string
+    VariableDefinition *def = (VariableDefinition *)id->resolve();
+    e << "for (" << (def->mutated ? "std::string " : "javelin::character ")
+      << id->name << " : javelin::string_itr(";
+    generate(e);
+    e << ")) {\n";
+    return;
   }
+
   // Default for header
-  cout << "for (" << t->cpp_type_string() << ' ' << id->name << " : ";
-  generate();
-  cout << ") {" << endl;
+  generate_for_start(e, t->get_itr_type(), id);
+  generate(e);
+  e << ") {\n";
 }
 
 NFunctionDeclStatement::
 NFunctionDeclStatement(NIdentifier *id, NArgs *args, Type *type,
                        NStatement *stmt) :
-    id(id), args(args), type(type), stmt(stmt) {
-  scope->addDefinition(id->name, new FunctionDefinition(this));
+    id(id), args(args), type(type), stmt(stmt), reachable(false),
+    cached(false), pure(false), recursive(false), memoized(false),
+    constexprValue(NULL), loops(false), accumulates(false) {
+  Context *ctx = Context::current();
+  ctx->funcStmts.push_back(this);
+
+  generic = ctx->specializing;
+  if (generic == NULL) {
+    scope->addDefinition(id->symbol, ctx->make<FunctionDefinition>(this));
+    return;
+  }
+
+  // A version of a generic function - its untyped parameters take the
+  // types it's called with, and calls find it through the generic one
+  ctx->specializing = NULL;
+  for (size_t i = 0; i < args->size(); i++) {
+    if ((*args)[i]->type->isUnset()) {
+      (*args)[i]->type = ctx->specializingTypes[i];
+    }
+  }
+  generic->add(ctx->specializingTypes, ctx->make<FunctionDefinition>(this));
 }
 
-NReturn::NReturn(NExpression *expr) : expr(expr) {
+void NFunctionDeclStatement::decorate(NIdentifier *name) {
+  // Bare @lru_cache is the same thing, as of Python 3.8
+  if (name->name != "cache" && name->name != "lru_cache") {
+    throw std::runtime_error("Unknown decorator: @" + name->name);
+  }
+  if (type->isVoid()) {
+    throw std::runtime_error("@" + name->name + " on " + id->name
+                             + ", which doesn't return anything");
+  }
+  if ( ! hasHashableArgs()) {
+    throw std::runtime_error("@" + name->name + " on " + id->name
+                             + ", which takes more than ints and strs");
+  }
+  cached = true;
+}
+
+bool NFunctionDeclStatement::hasHashableArgs() {
+  TypeContext &types = Context::current()->types;
+  for (NArg *arg : args->args) {
+    Type *type = arg->get_type();
+    if (type != types.get_int() && type != types.get_string()) return false;
+  }
+  return true;
+}
+
+void NFunctionDeclStatement::generateMemoized(Emitter &e) {
+  string rtype = type->cpp_type_string();
+  e.line() << "static javelin::memo<" << rtype << '(';
+  for (size_t i = 0; i < args->size(); i++) {
+    if (i > 0) e << ',';
+    e << (*args)[i]->get_type()->cpp_type_string();
+  }
+  e << ")> javelin_memo;\n";
+
+  e.line() << "return javelin_memo([&]() -> " << rtype << " {\n";
+  e.indent();
+  generateBody(e);
+  e.dedent();
+  e.line() << '}';
+  for (NArg *arg : args->args) {
+    e << ", " << arg->id->name;
+  }
+  e << ");\n";
+}
+
+NReturn::NReturn(NExpression *expr)
+    : expr(expr), tailCall(NULL), accumulated(NULL) {
+  FunctionStack *funcStack = Context::current()->funcStack;
   if (funcStack == NULL) {
     throw std::runtime_error("Return statement outside of function");
   }
+  func = funcStack->stmt;
+  func->returns.push_back(this);
 
-  Type *type = expr ? expr->get_type() : new VoidType();
+  Type *type = expr ? expr->get_type() : Context::current()->types.get_void();
   Type *declaredType = funcStack->get_type();
 
   if (declaredType->isUnset()) {
@@ -46,126 +135,544 @@ NReturn::NReturn(NExpression *expr) : expr(expr) {
 NFunctionCallExpression::
 NFunctionCallExpression(NIdentifier *id, NExpressionArgs *args):
     id(id), args(args) {
-  Definition *def = scope->findDefinition(id->name);
+  Definition *def = scope->findDefinition(id->symbol);
   if (def == NULL) {
     throw std::runtime_error(id->name + " function is undefined");
   }
   if ( ! def->isFunction()) {
     throw std::runtime_error(id->name + " is not defined as a function");
   }
-  if ( ! ((FunctionDefinition *)def)->argsMatch(args)) {
+  definition = ((FunctionDefinition *)def)->specialize(args);
+  for (NKeywordArg *arg : args->keywords) {
+    if ( ! definition->acceptsKeyword(arg->id->name)) {
+      throw std::runtime_error(id->name + "() got an unexpected keyword argument '"
+                               + arg->id->name + "'");
+    }
+  }
+  if ( ! definition->argsMatch(args)) {
     throw std::runtime_error("Type mismatch");
   }
+  if (definition->borrowsArgs()) {
+    for (NExpression *expr : args->exprs) {
+      expr->borrow();
+    }
+  }
 }
 
-Type* NFunctionCallExpression::get_type() {
-  Definition *d = scope->findDefinition(id->name);
-  if ( ! d->isFunction()) {
-    throw std::runtime_error(id->name + " is not a function");
+Type* NFunctionCallExpression::infer_type() {
+  return definition->get_type();
+}
+
+void NExpression::generate_extend(Emitter &e, NIdentifier *target) {
+  e << "javelin::extend(" << target->name << ", ";
+  generate(e);
+  e << ')';
+}
+
+NAugAssignment *NBinaryOperator::in_place_form(NIdentifier *target) {
+  Context *ctx = Context::current();
+  Definition *def = target->resolve();
+
+  if (isStringConcat()) {
+    // s = s + a + b is s += a + b, as long as s comes first
+    std::vector<NExpression *> parts;
+    collect_concat_parts(parts);
+    if ( ! parts[0]->refersTo(def)) return NULL;
+
+    NExpression *rest = parts[1];
+    for (size_t i = 2; i < parts.size(); i++) {
+      rest = ctx->make<NBinaryOperator>(rest, N_ADD, parts[i]);
+    }
+    return ctx->make<NAugAssignment>(target, N_ADD, rest);
+  }
+
+  switch (op) {
+  case N_ADD: case N_SUB: case N_MUL: case N_DIV:
+  case N_SL: case N_SR: case N_BA: case N_BO: case N_BX:
+    if (lhs->refersTo(def)) {
+      return ctx->make<NAugAssignment>(target, op, rhs);
+    }
+    return NULL;
+  default:
+    return NULL;
   }
-  return ((FunctionDefinition *)d)->get_type();
 }
 
 NAssignment::
-NAssignment(NIdentifier *lhs, NExpression *rhs) : lhs(lhs), rhs(rhs) {
+NAssignment(NIdentifier *lhs, NExpression *rhs)
+    : lhs(lhs), rhs(rhs), inPlace(NULL), overwritten(false) {
   Type *type = rhs->get_type();
-  Definition *def = scope->findDefinition(lhs->name);
+  Definition *def = lhs->resolve();
   VariableDefinition *vdef = (VariableDefinition *)def;
 
   // FIXME accomodate conflicting function & class names
 
   if (def == NULL) {
-    scope->addDefinition(lhs->name, new VariableDefinition(type));
+    VariableDefinition *vdef = Context::current()->make<VariableDefinition>(type);
+    vdef->value = rhs;
+    scope->addDefinition(lhs->symbol, vdef);
   } else if (vdef->get_type()->isUnset()) {
     // For argument type implication
     lhs->set_type(type);
     vdef->set_type(type);
   // Already defined as a var
-  } else if (type->cpp_type_string() != vdef->type->cpp_type_string()) {
+  } else if (type != vdef->type) {
     throw std::runtime_error(lhs->name +
                              " was previously declared as a '" +
                              vdef->type->cpp_type_string() + "'");
   }
+
+  if (def != NULL) {
+    if (def->isVariable()) vdef->mutated = true;
+    inPlace = rhs->in_place_form(lhs);
+  }
 }
 
-void NAssignment::generate(int level) {
-  NStatement::generate(level);
+void NAssignment::generate(Emitter &e) {
+  if ( ! generates()) return;
+
+  if (inPlace) {
+    inPlace->generate(e);
+    return;
+  }
+  NStatement::generate(e);
+
+  // Nothing reads it back, so there's no need for the variable
+  VariableDefinition *vdef = (VariableDefinition *)lhs->resolve();
+  if (vdef->liveReads == 0) {
+    rhs->generate_discard(e);
+    e << ";\n";
+    return;
+  }
 
   // Only declare the type if it's not a root statement
   // Otherwise, a header is declared at the top of the file
   // Also, don't declare the type if the variable is already declared
-  Definition *def = scope->findDefinition(lhs->name);
-  VariableDefinition *vdef = (VariableDefinition *)def;
+
+  if (! vdef->hasGeneratedHeader && vdef->matrixDims() > 0) {
+    // Only ever this literal, so it can be laid out flat
+    vdef->hasGeneratedHeader = true;
+    rhs->generate_matrix(e, lhs->name);
+    e << ";\n";
+    return;
+  }
+
+  if (! vdef->hasGeneratedHeader && ! vdef->mutated && ! vdef->escapes()
+      && rhs->generate_static(e, lhs->name)) {
+    // Never changed or handed on, so the one copy can do for every run
+    vdef->hasGeneratedHeader = true;
+    e << ";\n";
+    return;
+  }
+
+  if (! vdef->hasGeneratedHeader && ! vdef->mutated && ! vdef->escapes()
+      && rhs->generate_view(e, lhs->name)) {
+    // Only ever looked at in place, so a slice can go on pointing into the
+    // original, and a range() needn't be made into a list
+    vdef->hasGeneratedHeader = true;
+    e << ";\n";
+    return;
+  }
 
   if (! vdef->hasGeneratedHeader) {
     // Earthquake, ignore it
-    cout << lhs->get_type()->cpp_type_string() << " ";
+    e << lhs->get_type()->cpp_type_string() << " ";
                 vdef->hasGeneratedHeader = true;
   }
-  lhs->generate();
-  cout << " = ";
-  rhs->generate();
-  cout << ";" << endl;
+  lhs->generate(e);
+  e << " = ";
+  rhs->generate(e);
+  e << ";\n";
+}
+
+NAugAssignment::
+NAugAssignment(NIdentifier *lhs, NOpType op, NExpression *rhs)
+    : lhs(lhs), op(op), rhs(rhs), overwritten(false) {
+  Definition *def = lhs->resolve();
+  if (def == NULL || ! def->isVariable()) {
+    throw std::runtime_error(lhs->name + " is not defined");
+  }
+  ((VariableDefinition *)def)->mutated = true;
+
+  Type *rhs_type = rhs->get_type();
+  if (lhs->get_type()->isUnset()) {
+    // For argument type implication
+    lhs->set_type(rhs_type);
+  }
+
+  TypeContext &types = Context::current()->types;
+  Type *type = lhs->get_type();
+  bool valid;
+  if (type == types.get_string() || type->isIndAssignible()) {
+    valid = op == N_ADD && rhs_type == type;
+  } else {
+    valid = type == types.get_int() && rhs_type == type;
+  }
+  if ( ! valid) {
+    throw std::runtime_error("Unsupported operand types for " +
+                             NOpType_str(op) + "=");
+  }
+}
+
+void NAugAssignment::generate(Emitter &e) {
+  if ( ! generates()) return;
+  NStatement::generate(e);
+
+  if (((VariableDefinition *)lhs->resolve())->liveReads == 0) {
+    rhs->generate_discard(e);
+    e << ";\n";
+    return;
+  }
+
+  Type *type = lhs->get_type();
+  if (type == Context::current()->types.get_string()) {
+    // Grow the string once for everything that gets added on
+    std::vector<NExpression *> parts;
+    rhs->collect_concat_parts(parts);
+    e << "javelin::append(" << lhs->name;
+    for (NExpression *part : parts) {
+      e << ", ";
+      part->generate_concat_part(e);
+    }
+    e << ')';
+  } else if (type->isIndAssignible()) {
+    rhs->generate_extend(e, lhs);
+  } else if (op == N_MOD) {
+    e << lhs->name << " = javelin::modulus(" << lhs->name << ", ";
+    rhs->generate(e);
+    e << ')';
+  } else {
+    e << lhs->name << ' ' << NOpType_str(op) << "= ";
+    rhs->generate(e);
+  }
+  e << ";\n";
+}
+
+Definition *NIdentifier::resolve() {
+  // A miss isn't kept, since the name may be defined later on
+  if (definition == NULL) {
+    definition = scope->findDefinition(symbol);
+  }
+  return definition;
+}
+
+int NIdentifier::matrix_dims() {
+  Definition *def = resolve();
+  if (def == NULL || ! def->isVariable()) return 0;
+  return ((VariableDefinition *)def)->matrixDims();
+}
+
+void NIdentifier::markRead() {
+  Definition *def = resolve();
+  if (def && def->isVariable()) ((VariableDefinition *)def)->reads++;
+}
+
+void NIdentifier::borrow() {
+  Definition *def = resolve();
+  if (def && def->isVariable()) ((VariableDefinition *)def)->borrows++;
 }
 
-Type* NIdentifier::get_type() {
-  auto vd = (VariableDefinition *)scope->findDefinition(name);
+Type* NIdentifier::infer_type() {
+  auto vd = (VariableDefinition *)resolve();
   if ( ! vd) throw std::runtime_error("Type for " + name + " not found");
   return vd->type;
 }
 
 void NIdentifier::set_type(Type *type) {
-  auto vd = (VariableDefinition *)scope->findDefinition(name);
+  auto vd = (VariableDefinition *)resolve();
   if (vd->get_type()->isUnset()) {
     vd->set_type(type);
-  } else if (vd->get_type()->cpp_type_string() != type->cpp_type_string()) {
+  } else if (vd->get_type() != type) {
     throw std::runtime_error(name + " is already a "
                              + vd->type->cpp_type_string());
   }
 }
 
-void NFunctionCallExpression::generate() {
-  // This will exist, since we check its existance in the constructor
-  FunctionDefinition *def = (FunctionDefinition *)scope->findDefinition(id->name);
-  def->generateCallForArgs(args);
+void NFunctionCallExpression::generate(Emitter &e) {
+  definition->generateCallForArgs(e, args);
 }
 
-void NFunctionCallExpression::generate_itr_header(NIdentifier *id) {
-  FunctionDefinition *def = (FunctionDefinition *)scope->findDefinition(this->id->name);
-  if (def->hasCustomIterator()) {
-    def->generateItrCallForArgs(id, args);
+void NFunctionCallExpression::generate_concat_part(Emitter &e) {
+  definition->generateConcatPartForArgs(e, args);
+}
+
+bool NFunctionCallExpression::generate_view(Emitter &e, const string &name) {
+  if ( ! definition->isLazy()) return false;
+  e << "const auto " << name << " = ";
+  generate(e);
+  return true;
+}
+
+void NFunctionCallExpression::generate_itr_header(Emitter &e, NIdentifier *id) {
+  if (definition->hasCustomIterator()) {
+    definition->generateItrCallForArgs(e, id, args);
   } else {
-    NExpression::generate_itr_header(id);
+    NExpression::generate_itr_header(e, id);
   }
 }
 
 NForStatement::NForStatement(NIdentifier *itr_name, NExpression *iterable, NStatement *stmt) :
     itr_name(itr_name), iterable(iterable), stmt(stmt) {
   Type *itr_type = iterable->get_type()->get_itr_type();
-  scope->addDefinition(itr_name->name, new VariableDefinition(itr_type));
+  VariableDefinition *def = Context::current()->make<VariableDefinition>(itr_type);
+  // The loop header declares it
+  def->hasGeneratedHeader = true;
+  scope->addDefinition(itr_name->symbol, def);
+  iterable->borrow();
 }
 
 NList::NList(NExpressionArgs *contents) : contents(contents) {
   // Validate the type of the list - for now, you must have at least one element.
-  if (contents == NULL) {
+  if (contents->size() == 0) {
     throw std::runtime_error("No type associated with list declaration");
-  } else {
-    type = new ListType(contents->expr->get_type());
   }
+  type = Context::current()->types.get_list((*contents)[0]->get_type());
 
   Type *itr_type = type->get_itr_type();
-  for (contents = contents->next; contents != NULL; contents = contents->next) {
-    Type *content_type = contents->expr->get_type();
-    if (content_type->cpp_type_string() != itr_type->cpp_type_string()) {
+  for (size_t i = 1; i < contents->size(); i++) {
+    Type *content_type = (*contents)[i]->get_type();
+    if (content_type != itr_type) {
       throw std::runtime_error("Type mismatch in " + itr_type->cpp_type_string() + " list");
     }
   }
 }
 
-void NList::generate() {
-  cout << '{';
-  if (contents != NULL) contents->generate();
-  cout << '}';
+bool NList::is_constant() {
+  for (NExpression *expr : contents->exprs) {
+    if ( ! expr->is_constant()) return false;
+  }
+  return true;
+}
+
+bool NList::collect_matrix(std::vector<size_t> &shape, size_t depth,
+                           std::vector<NExpression *> &cells) {
+  // The first row at each depth sets how long the rest have to be
+  if (depth == shape.size()) {
+    shape.push_back(contents->size());
+  } else if (depth > shape.size() || shape[depth] != contents->size()) {
+    return false;
+  }
+  for (NExpression *expr : contents->exprs) {
+    if ( ! expr->collect_matrix(shape, depth + 1, cells)) return false;
+  }
+  return true;
+}
+
+void NList::generate_matrix(Emitter &e, const string &name) {
+  std::vector<size_t> shape;
+  std::vector<NExpression *> cells;
+  collect_matrix(shape, 0, cells);
+
+  Type *cell_type = type;
+  for (size_t i = 0; i < shape.size(); i++) {
+    cell_type = cell_type->get_itr_type();
+  }
+
+  // Nothing but literals, so it only has to be built the once
+  if (is_constant()) e << "static ";
+  e << "const javelin::matrix<" << cell_type->cpp_type_string() << ", "
+    << (long long)shape.size() << "> " << name << "({";
+  for (size_t i = 0; i < shape.size(); i++) {
+    if (i > 0) e << ',';
+    e << (long long)shape[i];
+  }
+  e << "}, {";
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (i > 0) e << ',';
+    cells[i]->generate(e);
+  }
+  e << "})";
+}
+
+bool NList::generate_static(Emitter &e, const string &name) {
+  if ( ! is_constant()) return false;
+
+  e << "static const std::array<" << type->get_itr_type()->cpp_type_string()
+    << ", " << (long long)contents->size() << "> " << name << " = {";
+  generate(e);
+  e << '}';
+  return true;
+}
+
+void NList::generate_itr_header(Emitter &e, NIdentifier *id) {
+  if ( ! is_constant()) {
+    NExpression::generate_itr_header(e, id);
+    return;
+  }
+  // Built the first time round, rather than every time the loop starts
+  string name = e.temp("list");
+  generate_static(e, name);
+  e << ";\n";
+  e.line();
+  generate_for_start(e, type->get_itr_type(), id);
+  e << name << ") {\n";
+}
+
+void NList::generate(Emitter &e) {
+  e << '{';
+  contents->generate(e);
+  e << '}';
+}
+
+void NList::generate_extend(Emitter &e, NIdentifier *target) {
+  if (contents->size() == 1) {
+    e << target->name << ".push_back(";
+    contents->generate(e);
+    e << ')';
+  } else {
+    e << target->name << ".insert(" << target->name << ".end(), ";
+    generate(e);
+    e << ')';
+  }
+}
+
+// Braces on their own aren't an expression
+void NList::generate_discard(Emitter &e) {
+  e << get_type()->cpp_type_string();
+  generate(e);
+}
+
+void NArg::generate(Emitter &e) {
+  Type *t = get_type();
+  if (t->isCheapToCopy() || definition->mutated) {
+    // A copy the function is free to change (and callers' temporaries are
+    // moved in)
+    e << t->cpp_type_string() << ' ' << id->name;
+  } else {
+    e << "const " << t->cpp_type_string() << "& " << id->name;
+  }
+}
+
+NExpression *NIdentifier::counter_below(long long &from) {
+  Definition *def = resolve();
+  if (def == NULL || ! def->isVariable()) return NULL;
+  VariableDefinition *vdef = (VariableDefinition *)def;
+  from = vdef->from;
+  return vdef->below;
+}
+
+bool NListIndex::in_bounds() {
+  long long i, length;
+  if (index->const_int(i)) {
+    return i >= 0 && list_expr->const_len(length) && i < length;
+  }
+
+  // A range() counter, stopping at or before the end
+  long long from;
+  NExpression *below = index->counter_below(from);
+  if (below == NULL || from < 0) return false;
+  if (below->const_int(i)) {
+    return list_expr->const_len(length) && i <= length;
+  }
+  NExpression *of = below->length_of();
+  Definition *list = list_expr->variable();
+  return of && list && of->refersTo(list);
+}
+
+void NListIndex::generate(Emitter &e) {
+  // Python raises an IndexError, where C++ would read past the end
+  bool checks = Context::current()->options.checkIndices;
+
+  if (list_expr->matrix_dims() == 1) {
+    // The last index into a matrix, so go straight to the cell - checking
+    // each index on the way, unless they're all known to be fine
+    bool checked = checks && ! indices_in_bounds();
+    std::vector<NExpression *> indices;
+    NExpression *base = matrix_base(indices);
+    if (checked) {
+      e << "javelin::index(";
+      base->generate(e);
+      e << ", ";
+    } else {
+      base->generate(e);
+      e << '(';
+    }
+    for (size_t i = 0; i < indices.size(); i++) {
+      if (i > 0) e << ", ";
+      indices[i]->generate(e);
+    }
+    e << ')';
+    return;
+  }
+
+  if (checks && ! in_bounds()) {
+    e << "javelin::index(";
+    list_expr->generate(e);
+    e << ", ";
+    index->generate(e);
+    e << ')';
+    return;
+  }
+
+  // A string's characters are kept as characters, not chars
+  bool string = list_expr->get_type() == Context::current()->types.get_string();
+  if (string) e << "javelin::character(";
+  list_expr->generate_operand(e, UNARY_PRECEDENCE + 1);
+  e << "[";
+  index->generate(e);
+  e << "]";
+  if (string) e << ')';
+}
+
+NSlice::NSlice(NExpression *list_expr, NExpression *start, NExpression *stop) :
+    list_expr(list_expr), start(start), stop(stop), borrowed(false) {
+  Type *type = list_expr->get_type();
+  if ( ! type->isIndexible()) {
+    throw std::runtime_error("A " + type->cpp_type_string() + " can't be sliced");
+  }
+  Type *int_type = Context::current()->types.get_int();
+  if ((start && start->get_type() != int_type)
+      || (stop && stop->get_type() != int_type)) {
+    throw std::runtime_error("Slice indices must be ints");
+  }
+  list_expr->borrow();
+}
+
+bool NSlice::generate_view(Emitter &e, const string &name) {
+  // What it points into has to stay put for as long as the view is around
+  Definition *def = list_expr->variable();
+  if ( ! def || ! def->isVariable() || ((VariableDefinition *)def)->mutated) {
+    return false;
+  }
+
+  e << "const auto " << name << " = ";
+  generate_slice(e);
+  return true;
+}
+
+void NSlice::generate(Emitter &e) {
+  if (borrowed) {
+    generate_slice(e);
+    return;
+  }
+  // Kept, so it gets copied out into a list or string of its own
+  e << get_type()->cpp_type_string() << '(';
+  generate_slice(e);
+  e << ')';
+}
+
+void NSlice::generate_extend(Emitter &e, NIdentifier *target) {
+  e << "javelin::extend(" << target->name << ", ";
+  generate_slice(e);
+  e << ')';
+}
+
+void NSlice::generate_slice(Emitter &e) {
+  e << "javelin::slice(";
+  list_expr->generate(e);
+  e << ", ";
+  if (start) {
+    start->generate(e);
+  } else {
+    e << '0';
+  }
+  e << ", ";
+  if (stop) {
+    stop->generate(e);
+  } else {
+    e << "javelin::to_end";
+  }
+  e << ')';
 }
 
 string NOpType_str(NOpType t) {
@@ -189,6 +696,23 @@ string NOpType_str(NOpType t) {
   case N_BO: return "|";
   case N_BN: return "~";
   case N_BX: return "^";
+  case N_MOD: return "%";
   default:    return "<type string undeclared>";
   }
 }
+
+int NOpType_precedence(NOpType t) {
+  switch (t) {
+  case N_MUL: case N_DIV: case N_MOD: return 13;
+  case N_ADD: case N_SUB: return 12;
+  case N_SL: case N_SR: return 11;
+  case N_LT: case N_GT: case N_GTE: case N_LTE: return 10;
+  case N_EQ: case N_NEQ: return 9;
+  case N_BA: return 8;
+  case N_BX: return 7;
+  case N_BO: return 6;
+  case N_AND: return 5;
+  case N_OR: return 4;
+  default: return UNARY_PRECEDENCE;
+  }
+}
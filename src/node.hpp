@@ -9,16 +9,22 @@
 class NStatement;
 class NExpression;
 class NFunctionDeclStatement;
+class NFunctionCallExpression;
+class NReturn;
+class NAugAssignment;
+class NHoisted;
+class LoopInvariants;
 class Scope;
+class Definition;
+class VariableDefinition;
+class FunctionDefinition;
 class Type;
 
-extern Scope *currentScope;
-
+#include "context.hpp"
+#include "emitter.hpp"
 #include "scope.hpp"
 #include "type.hpp"
 
-using std::cout;
-using std::endl;
 using std::string;
 
 // Enum to denote operator types
@@ -42,67 +48,416 @@ typedef enum {
   N_BO,
   N_BX,
   N_BN,
+  N_MOD, // Only in %=, a plain % is a javelin::modulus() call
 } NOpType;
 
 string NOpType_str(NOpType t);
+// How tightly C++ binds the operator, higher is tighter
+int NOpType_precedence(NOpType t);
+// Tighter than any binary operator
+const int UNARY_PRECEDENCE = 14;
+
+// Passes over the tree implement this, and get handed every node in turn
+class NVisitor {
+public:
+  virtual void visit(NStatement *stmt) {}
+  virtual void visit(NExpression *expr) {}
+};
 
 class NStatement {
 public:
   Scope *scope;
 
   NStatement() {
-    scope = currentScope;
+    scope = Context::current()->currentScope;
   }
 
-  void printIndent(int level) {
-    for (int i = 0; i < level; i++) {
-      cout << "  ";
-    }
+  virtual void generate(Emitter &e) {
+    e.line();
+  }
+
+  // Visits this statement, and then everything it contains
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+  }
+
+  // Folds the constants in this - hands back whatever should replace it
+  virtual NStatement *fold() {
+    return this;
+  }
+
+  // Notes down the stores this makes that can't just be dropped
+  virtual void mark_stores() {}
+  // If all this does is store to a variable, the variable
+  virtual Definition *only_stores() {
+    return NULL;
+  }
+  // If this stores over a variable without reading it first, the variable
+  virtual Definition *overwrites() {
+    return NULL;
   }
+  // Leaves out the store this makes, as it's stored over before it's read
+  virtual void drop_store() {}
+  // Whether that's been done
+  virtual bool dropped() {
+    return false;
+  }
+  // Whether generating this writes out anything at all
+  virtual bool generates() {
+    return true;
+  }
+  // Whether this is, or holds, a break, continue or return - so what
+  // follows it might not run
+  virtual bool jumps() {
+    return false;
+  }
+  // For a block, drops the stores in it that are stored over before
+  // they're read
+  virtual void drop_overwritten_stores() {}
 
-  virtual void generate(int level) {
-    printIndent(level);
+  // The variable this stores to, if it does
+  virtual Definition *stored() {
+    return NULL;
+  }
+  // If this is an update, like x += y, the update
+  virtual NAugAssignment *in_place() {
+    return NULL;
+  }
+  // Whether this can skip ahead to the next run of the loop it's in
+  virtual bool continues() {
+    return false;
+  }
+  // The statement this finishes on - itself, unless it's a block
+  virtual NStatement *last() {
+    return this;
+  }
+  // Drops that statement from a block
+  virtual void drop_last() {}
+  // Works out the loop invariants in this once, before the loop
+  virtual void hoist_invariants(LoopInvariants &loop) {}
+  // For a loop, moves what it can out of it
+  virtual void optimise_loop() {}
+  // For a loop over a range(), notes what its counter stays between
+  virtual void bound_counter() {}
+
+  /*
+   * What running this hands back, as a single expression - given that rest
+   * is what gets handed back if it runs off the end. NULL if it does
+   * anything that can't be put that way.
+   */
+  virtual NExpression *as_value(NExpression *rest) {
+    return NULL;
   }
 
   virtual void addToRootStmts() {
-    extern std::vector<NStatement*> rootStmts;
-    rootStmts.push_back(this);
+    Context::current()->rootStmts.push_back(this);
   }
 };
 
 // A block ks defined as a collection of statements (inside curly braces)
 class NBlock : public NStatement {
 public:
-  NStatement *stmt;
-  NBlock *next;
-  
-  NBlock(NStatement *stmt, NBlock *next) : stmt(stmt), next(next) { }
+  std::vector<NStatement *> stmts;
+
+  NBlock() {}
+
+  void add(NStatement *stmt) {
+    stmts.push_back(stmt);
+  }
 
-  virtual void generate(int level) {
-    stmt->generate(level);
-    if (next) {
-      next->generate(level);
+  virtual void generate(Emitter &e) {
+    for (NStatement *stmt : stmts) {
+      stmt->generate(e);
     }
   }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    for (NStatement *stmt : stmts) {
+      stmt->walk(v);
+    }
+  }
+
+  virtual void drop_overwritten_stores();
+
+  virtual bool generates() {
+    for (NStatement *stmt : stmts) {
+      if (stmt->generates()) return true;
+    }
+    return false;
+  }
+
+  virtual bool jumps() {
+    for (NStatement *stmt : stmts) {
+      if (stmt->jumps()) return true;
+    }
+    return false;
+  }
+
+  virtual bool continues() {
+    for (NStatement *stmt : stmts) {
+      if (stmt->continues()) return true;
+    }
+    return false;
+  }
+
+  virtual NStatement *last() {
+    return stmts.empty() ? this : stmts.back();
+  }
+
+  virtual void drop_last() {
+    stmts.pop_back();
+  }
+
+  virtual void hoist_invariants(LoopInvariants &loop) {
+    for (NStatement *stmt : stmts) {
+      stmt->hoist_invariants(loop);
+    }
+  }
+
+  virtual NStatement *fold();
+  virtual NExpression *as_value(NExpression *rest);
+};
+
+// A block that has lost the statement it belonged to, but keeps its scope
+class NCompoundStatement : public NStatement {
+public:
+  NStatement *stmt;
+
+  NCompoundStatement(NStatement *stmt) : stmt(stmt) {}
+
+  virtual void generate(Emitter &e) {
+    // No empty braces for a block that's had everything dropped
+    if ( ! generates()) return;
+    NStatement::generate(e);
+    e << "{\n";
+    e.indent();
+    stmt->generate(e);
+    e.dedent();
+    e.line() << "}\n";
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    stmt->walk(v);
+  }
+
+  virtual NExpression *as_value(NExpression *rest) {
+    return stmt->as_value(rest);
+  }
+
+  virtual bool generates() {
+    return stmt->generates();
+  }
+
+  virtual bool jumps() {
+    return stmt->jumps();
+  }
+
+  virtual bool continues() {
+    return stmt->continues();
+  }
+
+  virtual void hoist_invariants(LoopInvariants &loop) {
+    stmt->hoist_invariants(loop);
+  }
 };
 
 class NExpression {
+protected:
+  // Filled in by the type checker, or the first get_type() that pins it down
+  Type *resolved;
+
+  // Works out the type from scratch - get_type() caches this
+  virtual Type* infer_type() = 0;
+
 public:
   Scope *scope;
 
-  NExpression() {
-    scope = currentScope;
+  NExpression() : resolved(NULL) {
+    scope = Context::current()->currentScope;
+  }
+
+  Type* get_type() {
+    if (resolved) return resolved;
+
+    Type *type = infer_type();
+    // An unset type may still be implied later on, so don't hang on to it
+    if ( ! type->isUnset()) resolved = type;
+    return type;
   }
 
-  virtual Type* get_type() = 0;
   virtual void set_type(Type *type) {
-    if (get_type()->cpp_type_string() != type->cpp_type_string()) {
+    if (get_type() != type) {
       throw std::runtime_error("Cannot set this expression to a "
                                + type->cpp_type_string());
     }
   }
-  virtual void generate() = 0;
-  virtual void generate_itr_header(NIdentifier *id);
+  virtual void generate(Emitter &e) = 0;
+  /*
+   * Generate this as an operand of something that binds this tightly
+   * Python's precedence is already in the tree, so anything C++ would
+   * group differently gets bracketed.
+   */
+  virtual void generate_operand(Emitter &e, int precedence) {
+    generate(e);
+  }
+  virtual void generate_itr_header(Emitter &e, NIdentifier *id);
+
+  // Break a string + chain down into the pieces javelin::concat() joins
+  virtual void collect_concat_parts(std::vector<NExpression *> &parts) {
+    parts.push_back(this);
+  }
+  // Generate this as one of those pieces
+  virtual void generate_concat_part(Emitter &e) {
+    generate(e);
+  }
+
+  // Whether this is an int known at compile time, and if so which
+  virtual bool const_int(long long &value) {
+    return false;
+  }
+  // The same, for a string
+  virtual bool const_str(string &value) {
+    return false;
+  }
+  // Whether its len() is known at compile time
+  virtual bool const_len(long long &length) {
+    return false;
+  }
+  // Folds the constants in this - hands back whatever should replace it
+  virtual NExpression *fold() {
+    return this;
+  }
+
+  // Whether working this out could do anything besides give a value
+  virtual bool has_side_effects() {
+    return true;
+  }
+  // Counts this as a read that made it into the final program
+  virtual void mark_live() {}
+  // The function this calls, if it's a call
+  virtual FunctionDefinition *called() {
+    return NULL;
+  }
+  // If this is a call of func, the call
+  virtual NFunctionCallExpression *self_call(NFunctionDeclStatement *func) {
+    return NULL;
+  }
+  /*
+   * If this is x op func(...), or func(...) op x, for an op that doesn't mind
+   * which way round or how it's grouped - the call, along with op and x
+   */
+  virtual NFunctionCallExpression *accumulated_call(NFunctionDeclStatement *func,
+                                                    NOpType &op,
+                                                    NExpression *&rest) {
+    return NULL;
+  }
+
+  // Whether this is a literal, or a list of nothing but literals
+  virtual bool is_constant() {
+    return false;
+  }
+  // Whether the C++ for this starts with a minus sign
+  virtual bool is_negative() {
+    long long value;
+    return const_int(value) && value < 0;
+  }
+  // For a constant list, declares name as a static array holding it
+  virtual bool generate_static(Emitter &e, const string &name) {
+    return false;
+  }
+  // For a view of something that stays put, declares name as that view
+  virtual bool generate_view(Emitter &e, const string &name) {
+    return false;
+  }
+  // For a rectangular list, declares name as a javelin::matrix holding it
+  virtual void generate_matrix(Emitter &e, const string &name) {
+    throw std::runtime_error("Only a list literal can be made into a matrix");
+  }
+
+  /*
+   * Flattens a list literal into its extents, and its cells in row order
+   * Fails for anything that isn't rectangular.
+   */
+  virtual bool collect_matrix(std::vector<size_t> &shape, size_t depth,
+                              std::vector<NExpression *> &cells) {
+    if (depth != shape.size()) return false;
+    cells.push_back(this);
+    return true;
+  }
+  // How many dimensions of a javelin::matrix this is, or 0 if it isn't one
+  virtual int matrix_dims() {
+    return 0;
+  }
+  // For a matrix cell, the matrix - with the indices it took to get there
+  virtual NExpression *matrix_base(std::vector<NExpression *> &indices) {
+    return this;
+  }
+
+  // Whether this is just a use of the given variable
+  virtual bool refersTo(Definition *def) {
+    return false;
+  }
+  // The variable, if this is just a use of one
+  virtual Definition *variable() {
+    return NULL;
+  }
+  // If this is a len() call, what it takes the len() of
+  virtual NExpression *length_of() {
+    return NULL;
+  }
+  // If looping over this counts up from from, the value it stops short of
+  virtual NExpression *counts_up(long long &from) {
+    return NULL;
+  }
+  // If this is a loop counter known to stay in [from, below), below
+  virtual NExpression *counter_below(long long &from) {
+    return NULL;
+  }
+  // Whether working this out could raise an error, on top of whatever its
+  // parts could
+  virtual bool may_raise() {
+    return false;
+  }
+  // Whether every index this takes is sure to be in range
+  virtual bool indices_in_bounds() {
+    return true;
+  }
+  // For a list known while transpiling, its i'th item
+  virtual NExpression *const_item(long long i) {
+    return NULL;
+  }
+  // Marks this as only looked at in place, and not kept anywhere
+  virtual void borrow() {}
+  // If assigning this to target could update target in place instead
+  // (x = x + y as x += y), the in place version
+  virtual NAugAssignment *in_place_form(NIdentifier *target) {
+    return NULL;
+  }
+  // target += this, for a list target
+  virtual void generate_extend(Emitter &e, NIdentifier *target);
+  // Works this out only for what doing so does, as a statement - cast, so
+  // the compiler doesn't warn that the value goes unused
+  virtual void generate_discard(Emitter &e) {
+    e << "(void)";
+    generate_operand(e, UNARY_PRECEDENCE);
+  }
+
+  // Whether working this out always works, and does nothing but give a
+  // value - so it can be worked out sooner, even if it wouldn't have been
+  virtual bool is_total() {
+    return false;
+  }
+  // Hands back this, with the parts that don't change over the loop
+  // worked out before it
+  virtual NExpression *hoist_invariants(LoopInvariants &loop) {
+    return this;
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+  }
 };
 
 // Some expressions can be standalone statements (e.g. function calls)
@@ -112,29 +467,49 @@ public:
 
   NExpressionStatement(NExpression *expr) : expr(expr), NStatement() {}
     
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    expr->generate();
-    cout << ";\n";
+  virtual void generate(Emitter &e) {
+    NStatement::generate(e);
+    expr->generate(e);
+    e << ";\n";
   }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    expr->walk(v);
+  }
+
+  virtual void hoist_invariants(LoopInvariants &loop);
+  virtual NStatement *fold();
 };
 
 class NPassStatement : public NStatement {
 public:
   NPassStatement() {}
 
-  virtual void generate(int level) {
+  virtual void generate(Emitter &e) {
     // pass does nothing :)
   }
+
+  virtual bool generates() {
+    return false;
+  }
+
+  virtual NExpression *as_value(NExpression *rest) {
+    return rest;
+  }
 };
 
 class NBreakStatement : public NStatement {
 public:
   NBreakStatement() {}
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "break;\n";
+  virtual void generate(Emitter &e) {
+    NStatement::generate(e);
+    e << "break;\n";
+  }
+
+  virtual bool jumps() {
+    return true;
   }
 };
 
@@ -142,22 +517,65 @@ class NContinueStatement : public NStatement {
 public:
   NContinueStatement() {}
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "continue;\n";
+  virtual void generate(Emitter &e) {
+    NStatement::generate(e);
+    e << "continue;\n";
+  }
+
+  virtual bool continues() {
+    return true;
+  }
+
+  virtual bool jumps() {
+    return true;
   }
 };
 
 class NIdentifier : public NExpression {
+  // What this use of the name refers to, once it has been found
+  Definition *definition;
+
 public:
   string name;
-  NIdentifier(const string& name) : name(name) { }
+  Symbol symbol;
+  NIdentifier(const string& name) : name(name), definition(NULL) {
+    symbol = Context::current()->symbols.intern(name);
+  }
+
+  // The definition this name refers to from its scope, or NULL
+  Definition *resolve();
+  // Counts this as a read of the variable's value
+  void markRead();
+  virtual void borrow();
+
+  virtual bool refersTo(Definition *def) {
+    return resolve() == def;
+  }
+
+  virtual Definition *variable() {
+    return resolve();
+  }
+
+  virtual NExpression *counter_below(long long &from);
+  virtual int matrix_dims();
+  virtual bool const_len(long long &length);
+  virtual NExpression *const_item(long long i);
+  virtual NExpression *fold();
+  virtual void mark_live();
 
-  virtual void generate() {
-    cout << name;
+  virtual bool has_side_effects() {
+    return false;
   }
 
-  virtual Type* get_type();
+  virtual bool is_total() {
+    return true;
+  }
+
+  virtual void generate(Emitter &e) {
+    e << name;
+  }
+
+  virtual Type* infer_type();
   virtual void set_type(Type *type);
 };
 
@@ -165,14 +583,33 @@ class NInteger : public NExpression {
 public:
   long long value;
   BasicType *type;
-  NInteger(long long value) : value(value) { type = new BasicType("int"); }
+  NInteger(long long value) : value(value) {
+    type = Context::current()->types.get_int();
+  }
 
-  Type* get_type() {
+  Type* infer_type() {
     return type; 
   }
 
-  virtual void generate() {
-    cout << value;
+  virtual bool is_constant() {
+    return true;
+  }
+
+  virtual bool has_side_effects() {
+    return false;
+  }
+
+  virtual bool is_total() {
+    return true;
+  }
+
+  virtual bool const_int(long long &value) {
+    value = this->value;
+    return true;
+  }
+
+  virtual void generate(Emitter &e) {
+    e << value;
   }
 };
 
@@ -180,24 +617,52 @@ class NString : public NExpression {
 public:
   string value;
   StringType *type;
-  NString(const char *value) {
-    this->value = string(value + 1, strlen(value) - 2);
-    type = new StringType();
+  // Which of the hoisted constants this is
+  int literal;
+  // Without its quotes
+  NString(const string &value) {
+    this->value = value;
+    type = Context::current()->types.get_string();
+    literal = Context::current()->literals.intern(value);
   }
 
-  Type* get_type() {
+  // Escapes are left for the C++ compiler, so only plain text is known
+  bool isPlain() {
+    return value.find('\\') == string::npos;
+  }
+
+  Type* infer_type() {
     return type;
   }
 
-  virtual void generate() {
-    cout << "std::string(\"" << value << "\")";
+  virtual bool is_constant() {
+    return true;
   }
-  
-  virtual void generate_itr_header(NIdentifier *id) {
-    cout << "for (std::string " << id->name << " : ";
-    cout << "javelin::string_itr(";
-    generate();
-    cout << ")) {" << endl;
+
+  virtual bool has_side_effects() {
+    return false;
+  }
+
+  virtual bool is_total() {
+    return true;
+  }
+
+  virtual bool const_str(string &value) {
+    if ( ! isPlain()) return false;
+    value = this->value;
+    return true;
+  }
+
+  virtual bool const_len(long long &length) {
+    if ( ! isPlain()) return false;
+    length = value.length();
+    return true;
+  }
+
+  // Built once before main(), rather than every time this runs
+  virtual void generate(Emitter &e) {
+    Context::current()->literals.use(literal);
+    e << "javelin_literal_" << literal;
   }
 };
 
@@ -210,7 +675,7 @@ public:
   NBinaryOperator(NExpression *lhs, NOpType op, NExpression *rhs) :
     lhs(lhs), rhs(rhs), op(op) { }
 
-  Type* get_type() {
+  Type* infer_type() {
     Type *lhs_type = lhs->get_type();
     Type *rhs_type;
 
@@ -226,14 +691,73 @@ public:
   }
 
   void set_type(Type *type) {
+    // Both sides have already been checked against this
+    if (resolved == type) return;
     lhs->set_type(type);
     rhs->set_type(type);
   }
 
-  virtual void generate() {
-    lhs->generate();
-    cout << " " << NOpType_str(op) << " ";
-    rhs->generate();
+  bool isStringConcat() {
+    return op == N_ADD && get_type() == Context::current()->types.get_string();
+  }
+
+  virtual NAugAssignment *in_place_form(NIdentifier *target);
+  virtual NExpression *fold();
+  virtual NFunctionCallExpression *accumulated_call(NFunctionDeclStatement *func,
+                                                    NOpType &op,
+                                                    NExpression *&rest);
+  virtual bool is_total();
+  virtual NExpression *hoist_invariants(LoopInvariants &loop);
+
+  virtual bool has_side_effects() {
+    return lhs->has_side_effects() || rhs->has_side_effects();
+  }
+
+  virtual void collect_concat_parts(std::vector<NExpression *> &parts) {
+    if (isStringConcat()) {
+      lhs->collect_concat_parts(parts);
+      rhs->collect_concat_parts(parts);
+    } else {
+      parts.push_back(this);
+    }
+  }
+
+  virtual void generate(Emitter &e) {
+    if (isStringConcat()) {
+      // One allocation for the whole chain, rather than one per +
+      std::vector<NExpression *> parts;
+      collect_concat_parts(parts);
+      e << "javelin::concat(";
+      for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) e << ", ";
+        parts[i]->generate_concat_part(e);
+      }
+      e << ')';
+      return;
+    }
+
+    // All left associative, so the right needs brackets at the same level
+    int precedence = NOpType_precedence(op);
+    lhs->generate_operand(e, precedence);
+    e << " " << NOpType_str(op) << " ";
+    rhs->generate_operand(e, precedence + 1);
+  }
+
+  virtual void generate_operand(Emitter &e, int precedence) {
+    // A concat() is a call, which needs no brackets
+    if (isStringConcat() || NOpType_precedence(op) >= precedence) {
+      generate(e);
+    } else {
+      e << '(';
+      generate(e);
+      e << ')';
+    }
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    lhs->walk(v);
+    rhs->walk(v);
   }
 };
 
@@ -243,13 +767,92 @@ public:
   NExpression *rhs;
   NUnaryOperator(NOpType op, NExpression *rhs) : rhs(rhs), op(op) { }
 
-  Type* get_type() {
+  Type* infer_type() {
     return rhs->get_type();
   }
 
-  virtual void generate() {
-    cout << NOpType_str(op);
-    rhs->generate();
+  virtual bool is_constant() {
+    long long value;
+    return const_int(value);
+  }
+
+  virtual bool const_int(long long &value) {
+    if (op != N_SUB || ! rhs->const_int(value)) return false;
+    value = -value;
+    return true;
+  }
+
+  virtual NExpression *fold();
+
+  virtual bool has_side_effects() {
+    return rhs->has_side_effects();
+  }
+
+  virtual bool is_total() {
+    return rhs->is_total();
+  }
+
+  virtual NExpression *hoist_invariants(LoopInvariants &loop) {
+    rhs = rhs->hoist_invariants(loop);
+    return this;
+  }
+
+  virtual bool is_negative() {
+    return op == N_SUB;
+  }
+
+  virtual void generate(Emitter &e) {
+    e << NOpType_str(op);
+    // - -x, not the decrement --x
+    if (op == N_SUB && rhs->is_negative()) e << ' ';
+    rhs->generate_operand(e, UNARY_PRECEDENCE);
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    rhs->walk(v);
+  }
+};
+
+// cond ? then : otherwise - Python has no such thing, the passes make these
+class NConditional : public NExpression {
+public:
+  NExpression *cond;
+  NExpression *then;
+  NExpression *otherwise;
+
+  NConditional(NExpression *cond, NExpression *then, NExpression *otherwise) :
+    cond(cond), then(then), otherwise(otherwise) {}
+
+  Type* infer_type() {
+    return then->get_type();
+  }
+
+  virtual bool has_side_effects() {
+    return cond->has_side_effects() || then->has_side_effects()
+      || otherwise->has_side_effects();
+  }
+
+  // Looser than anything else, and right associative
+  virtual void generate(Emitter &e) {
+    cond->generate_operand(e, NOpType_precedence(N_OR));
+    e << " ? ";
+    then->generate(e);
+    e << " : ";
+    otherwise->generate(e);
+  }
+
+  virtual void generate_operand(Emitter &e, int precedence) {
+    e << '(';
+    generate(e);
+    e << ')';
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    cond->walk(v);
+    then->walk(v);
+    otherwise->walk(v);
   }
 };
 
@@ -257,16 +860,79 @@ class NAssignment : public NStatement {
 public:
   NIdentifier *lhs;
   NExpression *rhs;
+  // Set when this is really an update, like x = x + y
+  NAugAssignment *inPlace;
+  // Set when what this stores is always stored over before it's read
+  bool overwritten;
   NAssignment(NIdentifier *lhs, NExpression *rhs);
 
-  virtual void generate(int level);
+  virtual void generate(Emitter &e);
+  virtual NStatement *fold();
+  virtual void mark_stores();
+  virtual Definition *only_stores();
+  virtual Definition *overwrites();
+
+  virtual void drop_store() {
+    overwritten = true;
+  }
+  virtual bool dropped() {
+    return overwritten;
+  }
+  virtual bool generates();
+
+  virtual Definition *stored();
+  virtual void hoist_invariants(LoopInvariants &loop);
+
+  virtual NAugAssignment *in_place() {
+    return inPlace;
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    rhs->walk(v);
+  }
 
   virtual void addToRootStmts() {
     // We want it in both lists!
     NStatement::addToRootStmts();
 
-    extern std::vector<NAssignment*> rootAssignStmts;
-    rootAssignStmts.push_back(this);
+    Context::current()->rootAssignStmts.push_back(this);
+  }
+};
+
+// x += y and friends, which update x in place
+class NAugAssignment : public NStatement {
+public:
+  NIdentifier *lhs;
+  NOpType op;
+  NExpression *rhs;
+  // Set when what this stores is always stored over before it's read
+  bool overwritten;
+  NAugAssignment(NIdentifier *lhs, NOpType op, NExpression *rhs);
+
+  virtual void generate(Emitter &e);
+  virtual NStatement *fold();
+  virtual void mark_stores();
+  virtual Definition *only_stores();
+
+  virtual void drop_store() {
+    overwritten = true;
+  }
+  virtual bool dropped() {
+    return overwritten;
+  }
+  virtual bool generates();
+
+  virtual Definition *stored();
+  virtual void hoist_invariants(LoopInvariants &loop);
+
+  virtual NAugAssignment *in_place() {
+    return this;
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    rhs->walk(v);
   }
 };
 
@@ -274,19 +940,27 @@ class NWhileStatement : public NStatement {
 public:
   NExpression *expr;
   NStatement *stmt;
+  // Worked out once, before the loop
+  std::vector<NHoisted *> hoisted;
+  // Set when it's really a counted loop - the update it ends with, which
+  // has been taken out of stmt
+  NAugAssignment *step;
 
   NWhileStatement(NExpression *expr, NStatement *stmt) :
-    expr(expr), stmt(stmt) {}
-  
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "while (";
-    expr->generate();
-    cout << ") {" << endl;
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}" << endl;
+    expr(expr), stmt(stmt), step(NULL) {}
+
+  virtual void generate(Emitter &e);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    expr->walk(v);
+    stmt->walk(v);
+    if (step) step->walk(v);
   }
+
+  virtual NStatement *fold();
+  virtual bool jumps();
+  virtual void optimise_loop();
 };
 
 class NForStatement : public NStatement {
@@ -295,17 +969,24 @@ public:
   NExpression *iterable;
   NStatement *stmt;
 
+  // Worked out once, before the loop
+  std::vector<NHoisted *> hoisted;
+
   NForStatement(NIdentifier *itr_name, NExpression *iterable, NStatement *stmt);
   
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    Type *itr_type = iterable->get_type()->get_itr_type();
+  virtual void generate(Emitter &e);
 
-    iterable->generate_itr_header(itr_name);
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}" << endl;
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    iterable->walk(v);
+    stmt->walk(v);
   }
+
+  virtual NStatement *fold();
+  virtual Definition *stored();
+  virtual bool jumps();
+  virtual void optimise_loop();
+  virtual void bound_counter();
 };
 
 class NElseStatement : public NStatement {
@@ -314,12 +995,39 @@ public:
 
   NElseStatement(NStatement *stmt) : stmt(stmt) {}
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "else {" << endl;
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}" << endl;
+  virtual void generate(Emitter &e) {
+    if ( ! generates()) return;
+    NStatement::generate(e);
+    e << "else {\n";
+    e.indent();
+    stmt->generate(e);
+    e.dedent();
+    e.line() << "}\n";
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    stmt->walk(v);
+  }
+
+  virtual NExpression *as_value(NExpression *rest) {
+    return stmt->as_value(rest);
+  }
+
+  virtual bool generates() {
+    return stmt->generates();
+  }
+
+  virtual bool jumps() {
+    return stmt->jumps();
+  }
+
+  virtual bool continues() {
+    return stmt->continues();
+  }
+
+  virtual void hoist_invariants(LoopInvariants &loop) {
+    stmt->hoist_invariants(loop);
   }
 };
 
@@ -336,21 +1044,35 @@ public:
                  NElifStatement *elifStmt, NElseStatement *elseStmt) :
     expr(expr), stmt(stmt), elifStmt(elifStmt), elseStmt(elseStmt) {}
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "else if (";
-    expr->generate();
-    cout << ") {" << endl;
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}" << endl;
+  virtual void generate(Emitter &e) {
+    NStatement::generate(e);
+    e << "else if (";
+    expr->generate(e);
+    e << ") {\n";
+    e.indent();
+    stmt->generate(e);
+    e.dedent();
+    e.line() << "}\n";
 
     if (elifStmt) {
-      elifStmt->generate(level);
+      elifStmt->generate(e);
     } else if (elseStmt) { // huhu
-      elseStmt->generate(level);
+      elseStmt->generate(e);
     }
   }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    expr->walk(v);
+    stmt->walk(v);
+    if (elifStmt) elifStmt->walk(v);
+    if (elseStmt) elseStmt->walk(v);
+  }
+
+  virtual NExpression *as_value(NExpression *rest);
+  virtual bool jumps();
+  virtual bool continues();
+  virtual void hoist_invariants(LoopInvariants &loop);
 };
 
 class NIfStatement : public NStatement {
@@ -366,59 +1088,149 @@ public:
                NElifStatement *elifStmt, NElseStatement *elseStmt) :
     expr(expr), stmt(stmt), elifStmt(elifStmt), elseStmt(elseStmt) {}
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "if (";
-    expr->generate();
-    cout << ") {" << endl;
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}" << endl;
+  virtual void generate(Emitter &e) {
+    NStatement::generate(e);
+    e << "if (";
+    expr->generate(e);
+    e << ") {\n";
+    e.indent();
+    stmt->generate(e);
+    e.dedent();
+    e.line() << "}\n";
 
     if (elifStmt) {
-      elifStmt->generate(level);
+      elifStmt->generate(e);
     } else if (elseStmt) {
-      elseStmt->generate(level);
+      elseStmt->generate(e);
     }
   }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    expr->walk(v);
+    stmt->walk(v);
+    if (elifStmt) elifStmt->walk(v);
+    if (elseStmt) elseStmt->walk(v);
+  }
+
+  // Also drops the elifs that can never run
+  virtual NStatement *fold();
+  virtual NExpression *as_value(NExpression *rest);
+  virtual bool jumps();
+  virtual bool continues();
+  virtual void hoist_invariants(LoopInvariants &loop);
 };
 
-class NArgs {
+// A single function parameter
+class NArg {
 public:
   NIdentifier *id;
-  NArgs *next;
   Type *type;
+  // Filled in once the function's scope declares it
+  VariableDefinition *definition;
 
-  NArgs(NIdentifier *id, Type *type, NArgs *next)
-    : id(id), type(type), next(next) {}
+  NArg(NIdentifier *id, Type *type) : id(id), type(type), definition(NULL) {}
 
-  virtual Type* get_type() {
+  Type* get_type() {
     return type->isUnset() ? id->get_type() : type;
   }
 
-  virtual void generate() {
-    cout << get_type()->cpp_type_string() << " " << id->name;
+  void generate(Emitter &e);
+};
+
+// A function's parameter list
+class NArgs {
+public:
+  std::vector<NArg *> args;
+
+  NArgs() {}
 
-    if (next) {
-      cout << ',';
-      next->generate();
+  void add(NArg *arg) {
+    args.push_back(arg);
+  }
+
+  size_t size() {
+    return args.size();
+  }
+
+  NArg *operator[](size_t i) {
+    return args[i];
+  }
+
+  void generate(Emitter &e) {
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) e << ',';
+      args[i]->generate(e);
     }
   }
 };
 
+// A name=value argument to a call
+class NKeywordArg {
+public:
+  NIdentifier *id;
+  NExpression *value;
+
+  NKeywordArg(NIdentifier *id, NExpression *value) : id(id), value(value) {}
+};
+
+// Comma separated expressions, for calls and list literals
 class NExpressionArgs {
 public:
-  NExpression *expr;
-  NExpressionArgs *next;
+  std::vector<NExpression *> exprs;
+  // Only calls have these, and they always come after the positional ones
+  std::vector<NKeywordArg *> keywords;
 
-  NExpressionArgs(NExpression *expr, NExpressionArgs *next) :
-    expr(expr), next(next) {}
+  NExpressionArgs() {}
 
-  void generate() {
-    expr->generate();
-    if (next) {
-      cout << ',';
-      next->generate();
+  void add(NExpression *expr) {
+    if ( ! keywords.empty()) {
+      throw std::runtime_error("Positional argument follows keyword argument");
+    }
+    exprs.push_back(expr);
+  }
+
+  void addKeyword(NKeywordArg *arg) {
+    if (keyword(arg->id->name)) {
+      throw std::runtime_error("Keyword argument repeated: " + arg->id->name);
+    }
+    keywords.push_back(arg);
+  }
+
+  // The value passed for a keyword, or NULL
+  NExpression *keyword(const string &name) {
+    for (NKeywordArg *arg : keywords) {
+      if (arg->id->name == name) return arg->value;
+    }
+    return NULL;
+  }
+
+  size_t size() {
+    return exprs.size();
+  }
+
+  NExpression *operator[](size_t i) {
+    return exprs[i];
+  }
+
+  void generate(Emitter &e) {
+    for (size_t i = 0; i < exprs.size(); i++) {
+      if (i > 0) e << ',';
+      exprs[i]->generate(e);
+    }
+  }
+
+  void fold();
+  bool has_side_effects();
+  bool is_total();
+  void hoist_invariants(LoopInvariants &loop);
+
+  void walk(NVisitor &v) {
+    for (NExpression *expr : exprs) {
+      expr->walk(v);
+    }
+    for (NKeywordArg *arg : keywords) {
+      arg->value->walk(v);
     }
   }
 };
@@ -431,16 +1243,29 @@ public:
 
   NList(NExpressionArgs *contents);
 
-  Type* get_type() {
+  Type* infer_type() {
     return type;
   }
 
-  virtual void generate();
-  virtual void generate_itr_header(NIdentifier *id) {
-    Type *t = type->get_itr_type();
-    cout << "for (" << t->cpp_type_string() << ' ' << id->name << " : ";
-    generate();
-    cout << ") {" << endl;
+  virtual bool is_constant();
+  virtual bool const_len(long long &length);
+  virtual NExpression *const_item(long long i);
+  virtual NExpression *fold();
+  virtual bool has_side_effects() {
+    return contents->has_side_effects();
+  }
+  virtual bool collect_matrix(std::vector<size_t> &shape, size_t depth,
+                              std::vector<NExpression *> &cells);
+  virtual bool generate_static(Emitter &e, const string &name);
+  virtual void generate_matrix(Emitter &e, const string &name);
+  virtual void generate(Emitter &e);
+  virtual void generate_extend(Emitter &e, NIdentifier *target);
+  virtual void generate_discard(Emitter &e);
+  virtual void generate_itr_header(Emitter &e, NIdentifier *id);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    contents->walk(v);
   }
 };
 
@@ -450,17 +1275,132 @@ public:
   NExpression *index;
 
   NListIndex(NExpression *list_expr, NExpression *index) :
-      list_expr(list_expr), index(index) { }
+      list_expr(list_expr), index(index) {
+    list_expr->borrow();
+  }
 
-  virtual Type* get_type() {
+  virtual Type* infer_type() {
     return list_expr->get_type()->get_itr_type();
   }
 
-  virtual void generate() {
-    list_expr->generate();
-    cout << "[";
-    index->generate();
-    cout << "]";
+  virtual int matrix_dims() {
+    int dims = list_expr->matrix_dims();
+    return dims > 1 ? dims - 1 : 0;
+  }
+
+  virtual NExpression *matrix_base(std::vector<NExpression *> &indices) {
+    NExpression *base = list_expr->matrix_base(indices);
+    indices.push_back(index);
+    return base;
+  }
+
+  // Whether the index is sure to be in range, so needs no checking
+  bool in_bounds();
+
+  virtual bool may_raise() {
+    return Context::current()->options.checkIndices && ! in_bounds();
+  }
+
+  virtual bool indices_in_bounds() {
+    return in_bounds() && list_expr->indices_in_bounds();
+  }
+
+  virtual bool const_len(long long &length) {
+    NExpression *item = const_item();
+    return item && item->const_len(length);
+  }
+
+  // What this picks out, if that's known while transpiling
+  NExpression *const_item() {
+    long long i;
+    return index->const_int(i) ? list_expr->const_item(i) : NULL;
+  }
+
+  virtual NExpression *const_item(long long i) {
+    NExpression *item = const_item();
+    return item ? item->const_item(i) : NULL;
+  }
+
+  virtual void generate(Emitter &e);
+  virtual NExpression *fold();
+
+  // An IndexError can't be dropped along with the value
+  virtual bool has_side_effects() {
+    return may_raise() || list_expr->has_side_effects()
+      || index->has_side_effects();
+  }
+
+  virtual NExpression *hoist_invariants(LoopInvariants &loop) {
+    list_expr = list_expr->hoist_invariants(loop);
+    index = index->hoist_invariants(loop);
+    return this;
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    list_expr->walk(v);
+    index->walk(v);
+  }
+};
+
+/*
+ * xs[start:stop], either end of which can be left out
+ * Made as a view into the list or string, which is only copied out when
+ * it's kept as one.
+ */
+class NSlice : public NExpression {
+public:
+  NExpression *list_expr;
+  NExpression *start;
+  NExpression *stop;
+  // Only looked at in place, so it can stay a view
+  bool borrowed;
+
+  NSlice(NExpression *list_expr, NExpression *start, NExpression *stop);
+
+  virtual Type* infer_type() {
+    return list_expr->get_type();
+  }
+
+  // Where it starts and stops in something length long, if that's known
+  bool const_bounds(long long length, long long &from, long long &to);
+
+  virtual bool const_str(string &value);
+  virtual bool const_len(long long &length);
+  virtual NExpression *fold();
+
+  virtual bool has_side_effects() {
+    return list_expr->has_side_effects()
+      || (start && start->has_side_effects())
+      || (stop && stop->has_side_effects());
+  }
+
+  virtual NExpression *hoist_invariants(LoopInvariants &loop) {
+    list_expr = list_expr->hoist_invariants(loop);
+    if (start) start = start->hoist_invariants(loop);
+    if (stop) stop = stop->hoist_invariants(loop);
+    return this;
+  }
+
+  virtual void borrow() {
+    borrowed = true;
+  }
+
+  // The view itself, which points into what it was taken from
+  void generate_slice(Emitter &e);
+
+  virtual bool generate_view(Emitter &e, const string &name);
+  virtual void generate(Emitter &e);
+  virtual void generate_concat_part(Emitter &e) {
+    generate_slice(e);
+  }
+  virtual void generate_extend(Emitter &e, NIdentifier *target);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    list_expr->walk(v);
+    if (start) start->walk(v);
+    if (stop) stop->walk(v);
   }
 };
 
@@ -470,62 +1410,155 @@ public:
   NArgs *args;
   Type *type;
   NStatement *stmt;
+  // Set by the dead code pass, if anything that runs calls it
+  bool reachable;
+  // The generic function this is a version of, if it is one
+  GenericFunctionDefinition *generic;
+  // Set by @cache
+  bool cached;
+  // Set by the function pass - whether it does nothing but work out a value
+  // from its arguments, and whether it calls itself - other than in tail
+  // calls that just jump back to the top
+  bool pure;
+  bool recursive;
+  // Whether its results are kept in a javelin::memo
+  bool memoized;
+  // Its whole body as one expression, if it can be a constexpr function
+  NExpression *constexprValue;
+  // Every return in it, nested functions' aside
+  std::vector<NReturn *> returns;
+  // Set when it calls itself as the last thing it does, and so jumps back
+  // to the top instead - carrying a javelin_acc along, when the calls are
+  // like return n * f(n - 1)
+  bool loops;
+  bool accumulates;
+  NOpType accumulator;
 
   NFunctionDeclStatement(NIdentifier *id, NArgs *args, Type *type,
                          NStatement *stmt);
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
+  // Applies @name to it
+  void decorate(NIdentifier *name);
+  // Whether its arguments can be kept as a javelin::memo key
+  bool hasHashableArgs();
+
+  virtual bool generates() {
+    return reachable;
+  }
 
-    if (level == 0) {
-      cout << type->cpp_type_string() << ' ' << id->name << '(';
-      if (args) args->generate();
-      cout << ")";
+  virtual void generate(Emitter &e) {
+    // Nothing calls it, so it may as well not be there
+    if ( ! reachable) return;
+    NStatement::generate(e);
+
+    bool isLambda = e.depth() > 0;
+    if ( ! isLambda) {
+      if (constexprValue) e << "constexpr ";
+      e << type->cpp_type_string() << ' ' << id->name << '(';
+      args->generate(e);
+      e << ")";
+    } else if (recursive) {
+      // A lambda can't name itself, so it's kept in a std::function it can
+      // call through
+      e << "std::function<" << type->cpp_type_string() << '(';
+      for (size_t i = 0; i < args->size(); i++) {
+        if (i > 0) e << ',';
+        e << (*args)[i]->get_type()->cpp_type_string();
+      }
+      e << ")> " << id->name << ";\n";
+      e.line() << id->name << " = [&" << id->name << "] (";
+      args->generate(e);
+      e << ") -> " << type->cpp_type_string() << ' ';
     } else {
       // Lambdas don't capture by reference, by default.
-      cout << "auto " << id->name << " = [] (";
-      if (args) args->generate();
-      cout << ")";
+      e << "auto " << id->name << " = [] (";
+      args->generate(e);
+      e << ")";
       if (! type->isVoid()) {
-        cout << " -> " << type->cpp_type_string() << ' ';
+        e << " -> " << type->cpp_type_string() << ' ';
       }
     }
 
-    cout << " {\n";
-    stmt->generate(level + 1);
-    printIndent(level);
-    cout << "}";
-    if (level > 0) cout << ';'; // For lambdas
-    cout << endl;
+    e << " {\n";
+    e.indent();
+    if (constexprValue) {
+      // C++11 only allows the one return
+      e.line() << "return ";
+      constexprValue->generate(e);
+      e << ";\n";
+    } else if (memoized) {
+      generateMemoized(e);
+    } else {
+      generateBody(e);
+    }
+    e.dedent();
+    e.line() << "}";
+    if (isLambda) e << ';';
+    e << '\n';
+  }
+
+  // The body, run only for arguments it hasn't seen before
+  void generateMemoized(Emitter &e);
+  // The body, along with where its tail calls jump back to
+  void generateBody(Emitter &e);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    stmt->walk(v);
+  }
+
+  virtual NStatement *fold() {
+    stmt = stmt->fold();
+    return this;
   }
 
   // Generate the header - generally at the top of the file
-  void generateHeader() {
-    NStatement::generate(0);
+  void generateHeader(Emitter &e) {
+    e.line();
 
-    cout << type->cpp_type_string() << ' ' << id->name << '(';
-    if (args) args->generate();
-    cout << ");\n";
+    if (constexprValue) e << "constexpr ";
+    e << type->cpp_type_string() << ' ' << id->name << '(';
+    args->generate(e);
+    e << ");\n";
   }
 
   virtual void addToRootStmts() {
     // Don't store it in the rootStmts.. we treat functions specially
-    extern std::vector<NFunctionDeclStatement*> rootFuncStmts;
-    rootFuncStmts.push_back(this);
+    Context::current()->rootFuncStmts.push_back(this);
   }
 };
 
 class NReturn : public NStatement {
 public:
   NExpression *expr;
+  // The function it returns from
+  NFunctionDeclStatement *func;
+  // Set when it returns func's own result - which it works out by jumping
+  // back to the top. What that result gets combined with, if anything.
+  NFunctionCallExpression *tailCall;
+  NExpression *accumulated;
 
   NReturn(NExpression *expr);
 
-  virtual void generate(int level) {
-    NStatement::generate(level);
-    cout << "return ";
-    if (expr) expr->generate();
-    cout << ';' << endl;
+  virtual void generate(Emitter &e);
+  void generateTailCall(Emitter &e);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    if (expr) expr->walk(v);
+  }
+
+  virtual NStatement *fold() {
+    if (expr) expr = expr->fold();
+    return this;
+  }
+
+  virtual NExpression *as_value(NExpression *rest) {
+    return expr;
+  }
+
+  virtual bool jumps() {
+    return true;
   }
 };
 
@@ -533,10 +1566,77 @@ class NFunctionCallExpression : public NExpression {
 public:
   NIdentifier *id;
   NExpressionArgs *args;
+  // Looked up (and checked) once, when the call is parsed
+  FunctionDefinition *definition;
 
   NFunctionCallExpression(NIdentifier *id, NExpressionArgs *args);
 
-  virtual Type* get_type();
-  virtual void generate();
-  virtual void generate_itr_header(NIdentifier *id);
+  virtual Type* infer_type();
+  virtual void generate(Emitter &e);
+  virtual bool generate_view(Emitter &e, const string &name);
+  virtual void generate_itr_header(Emitter &e, NIdentifier *id);
+  virtual void generate_concat_part(Emitter &e);
+  virtual NExpression *fold();
+  virtual bool has_side_effects();
+  virtual bool is_total();
+  virtual NExpression *hoist_invariants(LoopInvariants &loop);
+
+  virtual void generate_discard(Emitter &e) {
+    generate(e);
+  }
+
+  virtual FunctionDefinition *called() {
+    return definition;
+  }
+
+  virtual NFunctionCallExpression *self_call(NFunctionDeclStatement *func) {
+    return definition->stmt == func ? this : NULL;
+  }
+
+  virtual NExpression *length_of() {
+    return definition->lengthOf(args);
+  }
+
+  virtual NExpression *counts_up(long long &from) {
+    return definition->countsUp(args, from);
+  }
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    args->walk(v);
+  }
+};
+
+// A loop invariant, worked out once before the loop and read from there
+class NHoisted : public NExpression {
+public:
+  NExpression *expr;
+  // Only named when the loop it comes before is generated
+  string name;
+
+  NHoisted(NExpression *expr) : expr(expr) {}
+
+  Type* infer_type() {
+    return expr->get_type();
+  }
+
+  virtual bool has_side_effects() {
+    return false;
+  }
+
+  virtual bool is_total() {
+    return true;
+  }
+
+  virtual void generate(Emitter &e) {
+    e << name;
+  }
+
+  // const T name = expr;
+  void generateDeclaration(Emitter &e);
+
+  virtual void walk(NVisitor &v) {
+    v.visit(this);
+    expr->walk(v);
+  }
 };
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "context.hpp"
+
+// Passes run over the whole tree, between parsing and code generation
+
+// Resolves the type of every expression once, so codegen only reads them
+void typecheck(Context *ctx);
+
+// Works out whatever it can while transpiling, and drops the branches that
+// can never run
+void fold(Context *ctx);
+
+// Turns functions that call themselves last thing into loops
+void eliminate_tail_calls(Context *ctx);
+
+// Notes the bounds range() loop counters stay between, which is what shows
+// an index doesn't need checking
+void bound_counters(Context *ctx);
+
+// Works out which functions are pure, and which of those get memoized or
+// made constexpr
+void analyse_functions(Context *ctx);
+
+// Works out what doesn't change over a loop just the once, before it, and
+// makes counted while loops into for loops
+void optimise_loops(Context *ctx);
+
+// Drops the functions nothing calls, and the stores nothing reads - either
+// as nothing reads the variable, or as they get stored over first
+void eliminate_dead_code(Context *ctx);
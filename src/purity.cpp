@@ -0,0 +1,146 @@
+#include "node.hpp"
+#include "passes.hpp"
+
+// The types of the running transpile
+static TypeContext& types() {
+  return Context::current()->types;
+}
+
+/*
+ * Looks for calls a pure function can't make, and errors it could raise
+ * A function can't see any variable but its own, so those are the only
+ * ways it can do anything besides work out its value.
+ */
+class PurityCheck : public NVisitor {
+public:
+  NFunctionDeclStatement *func;
+  bool impure;
+  bool recursive;
+
+  PurityCheck(NFunctionDeclStatement *func)
+    : func(func), impure(false), recursive(false) {}
+
+  // Whether a call to itself is one of the tail calls that became a jump
+  bool jumpsBack(NExpression *call) {
+    for (NReturn *ret : func->returns) {
+      if (ret->tailCall == call) return true;
+    }
+    return false;
+  }
+
+  virtual void visit(NExpression *expr) {
+    if (expr->may_raise()) impure = true;
+    FunctionDefinition *called = expr->called();
+    if (called == NULL) return;
+    if (called->stmt == func && ! jumpsBack(expr)) recursive = true;
+    if ( ! called->isPure()) impure = true;
+  }
+};
+
+// Looks for anything in a constexpr value that C++11 won't work out
+class ConstexprCheck : public NVisitor {
+public:
+  bool ok;
+
+  ConstexprCheck() : ok(true) {}
+
+  virtual void visit(NExpression *expr) {
+    FunctionDefinition *called = expr->called();
+    if (expr->get_type() != types().get_int()
+        || (called && ! called->isConstexpr())) {
+      ok = false;
+    }
+  }
+};
+
+NExpression *NBlock::as_value(NExpression *rest) {
+  // From the end back, each statement falls through to the ones after it
+  for (size_t i = stmts.size(); i > 0; i--) {
+    rest = stmts[i - 1]->as_value(rest);
+    if (rest == NULL) return NULL;
+  }
+  return rest;
+}
+
+// if expr: stmt, followed by whatever elif or else there is
+static NExpression *branch_value(NExpression *expr, NStatement *stmt,
+                                 NStatement *next, NExpression *rest) {
+  NExpression *then = stmt->as_value(rest);
+  NExpression *otherwise = next ? next->as_value(rest) : rest;
+  if (then == NULL || otherwise == NULL) return NULL;
+
+  // if x: pass - no need to look at x
+  if (then == otherwise) return then;
+  return Context::current()->make<NConditional>(expr, then, otherwise);
+}
+
+NExpression *NElifStatement::as_value(NExpression *rest) {
+  return branch_value(expr, stmt, elifStmt ? (NStatement *)elifStmt : elseStmt,
+                      rest);
+}
+
+NExpression *NIfStatement::as_value(NExpression *rest) {
+  return branch_value(expr, stmt, elifStmt ? (NStatement *)elifStmt : elseStmt,
+                      rest);
+}
+
+// Whether func could be a C++11 constexpr function, as far as it goes
+static bool constexpr_candidate(NFunctionDeclStatement *func) {
+  if ( ! func->pure || func->memoized || func->loops
+      || func->type != types().get_int()) {
+    return false;
+  }
+  for (NArg *arg : func->args->args) {
+    if (arg->get_type() != types().get_int()) return false;
+  }
+  return true;
+}
+
+void analyse_functions(Context *ctx) {
+  // Pure until shown otherwise, so functions that call each other can be
+  for (NFunctionDeclStatement *func : ctx->funcStmts) {
+    func->pure = func->hasHashableArgs() && ! func->type->isVoid();
+    PurityCheck check(func);
+    func->stmt->walk(check);
+    func->recursive = check.recursive;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (NFunctionDeclStatement *func : ctx->funcStmts) {
+      if ( ! func->pure) continue;
+      PurityCheck check(func);
+      func->stmt->walk(check);
+      if (check.impure) {
+        func->pure = false;
+        changed = true;
+      }
+    }
+  }
+
+  for (NFunctionDeclStatement *func : ctx->funcStmts) {
+    func->memoized = func->cached
+      || (ctx->options.memoize && func->pure && func->recursive
+          && ! func->loops);
+  }
+
+  // Only root functions can be constexpr - a lambda can't be, in C++11
+  for (NFunctionDeclStatement *func : ctx->rootFuncStmts) {
+    if (constexpr_candidate(func)) {
+      func->constexprValue = func->stmt->as_value(NULL);
+    }
+  }
+  changed = true;
+  while (changed) {
+    changed = false;
+    for (NFunctionDeclStatement *func : ctx->rootFuncStmts) {
+      if ( ! func->constexprValue) continue;
+      ConstexprCheck check;
+      func->constexprValue->walk(check);
+      if ( ! check.ok) {
+        func->constexprValue = NULL;
+        changed = true;
+      }
+    }
+  }
+}
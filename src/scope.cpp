@@ -2,56 +2,87 @@
 #include "node.hpp"
 #include "scope.hpp"
 
-Scope *currentScope;
-FunctionStack *funcStack;
+// The canonical types of the running transpile
+static TypeContext& types() {
+  return Context::current()->types;
+}
 
-void Scope::addDefinition(string name, Definition *definition) {
-  if (table.find(name) != table.end()) {
-    throw std::runtime_error("Definition '" + name +
+void Scope::addDefinition(Symbol symbol, Definition *definition) {
+  auto itr = table.find(symbol);
+  if (itr != table.end()) {
+    throw std::runtime_error("Definition '" +
+                             Context::current()->symbols.name(symbol) +
                              "' previously declared as a " +
-                             (table[name]->isFunction() ? "fun" : "var"));
+                             (itr->second->isFunction() ? "fun" : "var"));
   }
-  table[name] = definition;
+  table[symbol] = definition;
 }
 
-Definition * Scope::findDefinition(string name) {
-  auto itr = table.find(name);
-  if (itr != table.end()) {
-    return (*itr).second;
-  } else if (this->next != NULL) {
-    return this->next->findDefinition(name);
-  } else {
-    return NULL;
+void Scope::addDefinition(const string &name, Definition *definition) {
+  addDefinition(Context::current()->symbols.intern(name), definition);
+}
+
+Definition * Scope::findDefinition(Symbol symbol) {
+  // Innermost scope first
+  for (int i = path.size() - 1; i >= 0; i--) {
+    auto itr = path[i]->table.find(symbol);
+    if (itr != path[i]->table.end()) {
+      return itr->second;
+    }
   }
+  return NULL;
 }
 
 bool FunctionDefinition::argsMatch(NExpressionArgs *args) {
-  NExpressionArgs *itr1 = args;
-  NArgs *itr2 = stmt->args;
+  NArgs *params = stmt->args;
+  if (args->size() != params->size()) {
+    return false;
+  }
 
-  for (; itr1 && itr2; itr1 = itr1->next, itr2 = itr2->next) {
-    Type *itr1Type = itr1->expr->get_type();
-    Type *itr2Type = itr2->get_type();
-    if (itr1Type->cpp_type_string() != itr2Type->cpp_type_string()) {
+  for (size_t i = 0; i < args->size(); i++) {
+    if ((*args)[i]->get_type() != (*params)[i]->get_type()) {
       return false;
     }
   }
-  return itr1 == NULL && itr2 == NULL;
+  return true;
+}
+
+void FunctionDefinition::generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+  e << stmt->id->name << '(';
+  args->generate(e);
+  e << ')';
+}
+
+bool FunctionDefinition::isPure() {
+  return stmt->pure;
 }
 
-void FunctionDefinition::generateCallForArgs(NExpressionArgs *args) {
-  cout << stmt->id->name << '(';
-  if (args) args->generate();
-  cout << ')';
+bool FunctionDefinition::isConstexpr() {
+  return stmt->constexprValue != NULL;
 }
 
 Type* VariableDefinition::get_type() {
   return type;
 }
 
-ArgumentDefinition::ArgumentDefinition(NArgs *arg)
+int VariableDefinition::matrixDims() {
+  if (dims >= 0) return dims;
+
+  // It has to be one literal, rectangular all the way down, that stays put
+  std::vector<size_t> shape;
+  std::vector<NExpression *> cells;
+  dims = 0;
+  if (value && ! mutated && ! escapes()
+      && value->collect_matrix(shape, 0, cells) && shape.size() > 1) {
+    dims = shape.size();
+  }
+  return dims;
+}
+
+ArgumentDefinition::ArgumentDefinition(NArg *arg)
     : VariableDefinition(arg->type), arg(arg) {
   hasGeneratedHeader = true;
+  arg->definition = this;
 }
 
 void ArgumentDefinition::set_type(Type *type) {
@@ -63,227 +94,387 @@ Type* FunctionDefinition::get_type() {
   return stmt->type;
 }
 
-class LenDefinition : public FunctionDefinition {
+// One of the runtime's functions - neither pure nor constexpr, unless it says so
+class BuiltinDefinition : public FunctionDefinition {
 public:
-  LenDefinition() : FunctionDefinition(NULL) {}
+  BuiltinDefinition() : FunctionDefinition(NULL) {}
+
+  virtual bool isPure() {
+    return false;
+  }
+
+  virtual bool isConstexpr() {
+    return false;
+  }
+};
+
+class LenDefinition : public BuiltinDefinition {
+public:
+  virtual bool isPure() {
+    return true;
+  }
+
+  virtual bool isTotal() {
+    return true;
+  }
 
   virtual bool argsMatch(NExpressionArgs *args) {
-    if (args == NULL && args->next != NULL) {
+    if (args->size() != 1) {
       return false;
     }
     // Throws up if the type has no len
-    args->expr->get_type()->get_cpp_len_function();
+    (*args)[0]->get_type()->get_cpp_len_function();
+    return true;
+  }
+
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    Type *type = (*args)[0]->get_type();
+    // An int, like in python, so it compares with int counters
+    e << "(int)(";
+    (*args)[0]->generate(e);
+    e << ')' << type->get_cpp_len_function();
+  }
+
+  virtual bool borrowsArgs() {
     return true;
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    Type *type = args->expr->get_type();
-    std::cout << '(';
-    args->expr->generate();
-    std::cout << ')' << type->get_cpp_len_function();
+  virtual NExpression *lengthOf(NExpressionArgs *args) {
+    return (*args)[0];
+  }
+
+  virtual NExpression *foldCall(NExpressionArgs *args) {
+    long long length;
+    if ( ! (*args)[0]->const_len(length)) return NULL;
+    return Context::current()->make<NInteger>(length);
   }
 
   virtual Type* get_type() {
-    return new BasicType("int");
+    return types().get_int();
   }
 };
 
-class PrintDefinition : public FunctionDefinition {
+class PrintDefinition : public BuiltinDefinition {
 public:
-  PrintDefinition() : FunctionDefinition(NULL) {}
-
   virtual bool argsMatch(NExpressionArgs *args) {
-    for (; args != NULL; args = args->next) {
-      std::string type = args->expr->get_type()->cpp_type_string();
-      if (type != "std::string" && type != "int") {
+    for (NExpression *expr : args->exprs) {
+      Type *type = expr->get_type();
+      if (type != types().get_string() && type != types().get_int()) {
         return false;
       }
     }
+    NExpression *flush = args->keyword("flush");
+    return flush == NULL || flush->get_type() == types().get_int();
+  }
+
+  virtual bool acceptsKeyword(const string &name) {
+    return name == "flush";
+  }
+
+  virtual bool borrowsArgs() {
     return true;
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    cout << "std::cout";
-    for (; args != NULL; args = args->next) {
-      cout << " << ";
-      args->expr->generate();
-      // As per python, place spaces between the outputs
-      if (args->next) {
-        cout << " << ' '";
-      }
+  // Buffered by the runtime, which only writes it out when it has to
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    NExpression *flush = args->keyword("flush");
+    if (flush) {
+      e << "javelin::print_flush(";
+      flush->generate(e);
+      if (args->size() > 0) e << ',';
+    } else {
+      e << "javelin::print(";
     }
-    cout << " << std::endl";
+    args->generate(e);
+    e << ')';
+  }
+
+  virtual Type* get_type() {
+    return types().get_void();
   }
 };
 
-class StrCastDefinition : public FunctionDefinition {
+class StrCastDefinition : public BuiltinDefinition {
 public:
-  StrCastDefinition() : FunctionDefinition(NULL) {}
+  virtual bool isPure() {
+    return true;
+  }
+
+  virtual bool isTotal() {
+    return true;
+  }
 
   virtual bool argsMatch(NExpressionArgs *args) {
     // We only expect one argument for a string cast
-    if (args == NULL || args->next != NULL) return false;
+    if (args->size() != 1) return false;
 
-    std::string type = args->expr->get_type()->cpp_type_string();
-    return type == "int" || type == "std::string";
+    Type *type = (*args)[0]->get_type();
+    return type == types().get_int() || type == types().get_string();
+  }
+
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    Type *type = (*args)[0]->get_type();
+    if (type == types().get_string()) {
+      e << "std::string(";
+    } else if (type == types().get_int()) {
+      e << "std::to_string(";
+    }
+    (*args)[0]->generate(e);
+    e << ')';
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    std::string type = args->expr->get_type()->cpp_type_string();
-    if (type == "std::string") {
-      cout << "std::string(";
-    } else if (type == "int") {
-      cout << "std::to_string(";
+  virtual NExpression *foldCall(NExpressionArgs *args) {
+    NExpression *arg = (*args)[0];
+    long long value;
+    if (arg->const_int(value)) {
+      return Context::current()->make<NString>(std::to_string(value));
     }
-    args->expr->generate();
-    cout << ')';
+    string s;
+    return arg->const_str(s) ? arg : NULL;
+  }
+
+  // concat() formats ints itself, so str() has nothing left to do
+  virtual void generateConcatPartForArgs(Emitter &e, NExpressionArgs *args) {
+    (*args)[0]->generate_concat_part(e);
   }
 
   virtual Type* get_type() {
-    return new StringType();
+    return types().get_string();
   }
 };
 
-class IntCastDefinition : public FunctionDefinition {
+class IntCastDefinition : public BuiltinDefinition {
 public:
-  IntCastDefinition() : FunctionDefinition(NULL) {}
-
   virtual bool argsMatch(NExpressionArgs *args) {
     // We only expect one argument for a string cast
-    if (args == NULL || args->next != NULL) return false;
+    if (args->size() != 1) return false;
 
-    std::string type = args->expr->get_type()->cpp_type_string();
-    return type == "int" || type == "std::string";
+    Type *type = (*args)[0]->get_type();
+    return type == types().get_int() || type == types().get_string();
+  }
+
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    Type *type = (*args)[0]->get_type();
+    if (type == types().get_string()) {
+      e << "std::stoi(";
+      (*args)[0]->generate(e);
+      e << ')';
+    } else if (type == types().get_int()) {
+      (*args)[0]->generate(e);
+    }
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    std::string type = args->expr->get_type()->cpp_type_string();
-    if (type == "std::string") {
-      cout << "std::stoi(";
-      args->expr->generate();
-      cout << ')';
-    } else if (type == "int") {
-      args->expr->generate();
+  virtual NExpression *foldCall(NExpressionArgs *args) {
+    NExpression *arg = (*args)[0];
+    long long value;
+    if (arg->const_int(value)) return arg;
+
+    // Just the plain digits - anything else is left for stoi() to judge
+    string s;
+    if ( ! arg->const_str(s)) return NULL;
+    size_t start = s.length() > 0 && s[0] == '-' ? 1 : 0;
+    if (s.length() == start || s.length() - start > 9) return NULL;
+    for (size_t i = start; i < s.length(); i++) {
+      if (s[i] < '0' || s[i] > '9') return NULL;
     }
+    return Context::current()->make<NInteger>(std::stoll(s));
   }
 
   virtual Type* get_type() {
-    return new BasicType("int");
+    return types().get_int();
   }
 };
 
-class ExitDefinition : public FunctionDefinition {
+class ExitDefinition : public BuiltinDefinition {
 public:
-  ExitDefinition() : FunctionDefinition(NULL) {}
-
   virtual bool argsMatch(NExpressionArgs *args) {
-    return args && args->expr && args->next == NULL &&
-      args->expr->get_type()->cpp_type_string() == "int";
+    return args->size() == 1 && (*args)[0]->get_type() == types().get_int();
+  }
+
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    e << "exit(";
+    args->generate(e); // There will only be one of them
+    e << ')';
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    cout << "exit(";
-    args->generate(); // There will only be one of them
-    cout << ')';
+  virtual Type* get_type() {
+    return types().get_void();
   }
 };
 
-class ModulusDefinition : public FunctionDefinition {
+class ModulusDefinition : public BuiltinDefinition {
 public:
-  ModulusDefinition() : FunctionDefinition(NULL) {}
+  virtual bool isPure() {
+    return true;
+  }
 
   virtual bool argsMatch(NExpressionArgs *args) {
-    return args && args->expr && args->expr->get_type()->cpp_type_string() == "int"
-      && args->next && args->next->expr &&
-      args->next->expr->get_type()->cpp_type_string() == "int"
-      && args->next->next == NULL;
+    return args->size() == 2 && (*args)[0]->get_type() == types().get_int()
+      && (*args)[1]->get_type() == types().get_int();
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    cout << "javelin::modulus(";
-    args->generate(); // There will only be one of them
-    cout << ')';
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    e << "javelin::modulus(";
+    args->generate(e); // There will only be one of them
+    e << ')';
+  }
+
+  virtual bool isConstexpr() {
+    return true;
+  }
+
+  // Python's %, as javelin::modulus() works it out
+  virtual NExpression *foldCall(NExpressionArgs *args) {
+    long long a, b;
+    if ( ! (*args)[0]->const_int(a) || ! (*args)[1]->const_int(b) || b == 0
+        || (int)a != a || (int)b != b) {
+      return NULL;
+    }
+    return Context::current()->make<NInteger>(((a % b) + b) % b);
   }
 
   virtual Type* get_type() {
-    return new BasicType("int");
+    return types().get_int();
   }
 };
 
-class RangeDefinition : public FunctionDefinition {
+class RangeDefinition : public BuiltinDefinition {
 public:
-  RangeDefinition() : FunctionDefinition(NULL) {}
+  virtual bool isPure() {
+    return true;
+  }
 
   virtual bool argsMatch(NExpressionArgs *args) {
-    return args && args->expr && args->expr->get_type()->cpp_type_string() == "int"
-      && (args->next == NULL || args->next->expr->get_type()->cpp_type_string() == "int"
-          && args->next->next == NULL);
+    if (args->size() < 1 || args->size() > 3) return false;
+    for (NExpression *expr : args->exprs) {
+      if (expr->get_type() != types().get_int()) return false;
+    }
+    return true;
   }
 
-  virtual void generateCallForArgs(NExpressionArgs *args) {
-    // TODO if being used in an assignment, generate a list
-    throw std::runtime_error("range() does not support returning to a list.. yet");
+  // A lazy javelin::range, which only becomes a vector if it has to
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args) {
+    e << "javelin::range(";
+    args->generate(e);
+    e << ')';
   }
 
   virtual Type* get_type() {
-    return new ListType(new BasicType("int"));
+    return types().get_list(types().get_int());
+  }
+
+  virtual bool isLazy() {
+    return true;
   }
 
   virtual bool hasCustomIterator() {
     return true;
   }
 
-  virtual void generateItrCallForArgs(NIdentifier *id, NExpressionArgs *args) {
-    cout << "for (int " << id->name << " = ";
+  virtual NExpression *countsUp(NExpressionArgs *args, long long &from) {
+    from = 0;
+    if (args->size() > 1 && ! (*args)[0]->const_int(from)) return NULL;
+    // A bigger step still stays below the stop
+    long long by;
+    if (args->size() > 2 && ( ! (*args)[2]->const_int(by) || by <= 0)) {
+      return NULL;
+    }
+    return (*args)[args->size() > 1 ? 1 : 0];
+  }
 
-    if (args->next) {
-      // Double argument range
-      args->expr->generate();
-      args = args->next;
+  // A plain counted loop, which the C++ compiler can analyse and vectorise
+  virtual void generateItrCallForArgs(Emitter &e, NIdentifier *id, NExpressionArgs *args) {
+    NExpression *start = args->size() > 1 ? (*args)[0] : NULL;
+    NExpression *stop = (*args)[args->size() > 1 ? 1 : 0];
+    NExpression *step = args->size() > 2 ? (*args)[2] : NULL;
+    // Stepping by more than one could carry an int past INT_MAX on the way
+    // out, where python just stops, so then it counts in a long long
+    long long by = 1;
+    bool wide = step && ( ! step->const_int(by) || (by != 1 && by != -1));
+    // Assigning to the variable in the loop mustn't move the loop on, so
+    // then it counts with one of its own too
+    VariableDefinition *def = (VariableDefinition *)id->resolve();
+    string i = def->mutated || wide ? e.temp("i") : id->name;
+
+    e << "for (" << (wide ? "long long " : "int ") << i << " = ";
+    if (start) {
+      start->generate(e);
     } else {
-      // Single argument range
-      cout << '0';
+      e << '0';
+    }
+
+    if (step && ! step->const_int(by)) {
+      // Unknown direction, so count the trips up front
+      string step_var = e.temp("step");
+      string count = e.temp("count");
+      e << ", " << step_var << " = ";
+      step->generate(e);
+      e << ", " << count << " = javelin::range_count(" << i << ", ";
+      stop->generate(e);
+      e << ", " << step_var << "); " << count << " > 0; "
+        << count << "--, " << i << " += " << step_var << ") {\n";
+      generateItrCopy(e, id, i);
+      return;
+    }
+    if (by == 0) {
+      throw std::runtime_error("range() arg 3 must not be zero");
     }
 
-    cout << "; " << id->name << " < ";
-    args->expr->generate();
-    // Big hack to make it behave like the Python range iterable
-    // Please don't ask
-    cout << " || (" << id->name << "-- && false)"
-         << "; " << id->name << "++) {" << endl;
+    // The bound is only worked out once
+    string bound = e.temp("stop");
+    e << ", " << bound << " = ";
+    stop->generate(e);
+    e << "; " << i << (by > 0 ? " < " : " > ") << bound << "; ";
+    if (by == 1) {
+      e << i << "++";
+    } else if (by > 0) {
+      e << i << " += " << by;
+    } else {
+      e << i << " -= " << -by;
+    }
+    e << ") {\n";
+    generateItrCopy(e, id, i);
+  }
+
+  // The variable starting off each time round as the counter
+  void generateItrCopy(Emitter &e, NIdentifier *id, const string &counter) {
+    if (counter == id->name) return;
+    // Not needed if nothing reads it
+    if (((VariableDefinition *)id->resolve())->liveReads == 0) return;
+    e.indent();
+    e.line() << "int " << id->name << " = " << counter << ";\n";
+    e.dedent();
   }
 };
 
 void Scope::addStandardDefinitions() {
-  addDefinition("print", new PrintDefinition());
-  addDefinition("exit", new ExitDefinition());
-  addDefinition("str", new StrCastDefinition());
-  addDefinition("int", new IntCastDefinition());
-  addDefinition("javelin::modulus", new ModulusDefinition());
-  addDefinition("range", new RangeDefinition());
-  addDefinition("len", new LenDefinition());
+  Context *ctx = Context::current();
+  addDefinition("print", ctx->make<PrintDefinition>());
+  addDefinition("exit", ctx->make<ExitDefinition>());
+  addDefinition("str", ctx->make<StrCastDefinition>());
+  addDefinition("int", ctx->make<IntCastDefinition>());
+  addDefinition("javelin::modulus", ctx->make<ModulusDefinition>());
+  addDefinition("range", ctx->make<RangeDefinition>());
+  addDefinition("len", ctx->make<LenDefinition>());
 }
 
 FunctionScope::FunctionScope(Scope *next, NFunctionDeclStatement *stmt)
     : Scope(next) {
+  // Lookups stop here
+  path.assign(1, this);
   addStandardDefinitions();
 
-  addDefinition(stmt->id->name, new FunctionDefinition(stmt));
-
-  NArgs *args = stmt->args;
-  // Declare the args as local variables
-  for (; args != NULL; args = args->next) {
-    addDefinition(args->id->name, new ArgumentDefinition(args));
+  // Recursive calls to a generic function may want another version of it
+  Context *ctx = Context::current();
+  if (stmt->generic) {
+    addDefinition(stmt->id->symbol, stmt->generic);
+  } else {
+    addDefinition(stmt->id->symbol, ctx->make<FunctionDefinition>(stmt));
   }
-}
 
-Definition * FunctionScope::findDefinition(string name) {
-  //return Scope::findDefinition(name);
-  auto itr = table.find(name);
-  if (itr != table.end()) {
-    return (*itr).second;
-  } else {
-    return NULL;
+  // Declare the args as local variables
+  for (NArg *arg : stmt->args->args) {
+    addDefinition(arg->id->symbol, ctx->make<ArgumentDefinition>(arg));
   }
 }
 
@@ -2,15 +2,17 @@
 
 #include <unordered_map>
 #include <iostream>
+#include <vector>
 #include "node.hpp"
+#include "symbol.hpp"
 
 using std::string;
-using std::cout;
-using std::endl;
 
 class NIdentifier;
 class NExpressionArgs;
 class NArgs;
+class NArg;
+class NExpression;
 
 // A definition of a variable, function, or (in the future) class
 class Definition {
@@ -27,22 +29,130 @@ public:
   FunctionDefinition(NFunctionDeclStatement *stmt) : stmt(stmt) {}
   virtual bool isFunction() { return true; }
   virtual bool argsMatch(NExpressionArgs *args);
-  virtual void generateCallForArgs(NExpressionArgs *args);
+  // Only some builtins take keyword arguments
+  virtual bool acceptsKeyword(const string &name) { return false; }
+  // Whether the arguments are only looked at, and never kept
+  virtual bool borrowsArgs() { return false; }
+  // The call's value, if it can be worked out while transpiling
+  virtual NExpression *foldCall(NExpressionArgs *args) { return NULL; }
+  // The definition a call with these arguments should use - only generic
+  // functions have more than the one
+  virtual FunctionDefinition *specialize(NExpressionArgs *args) {
+    return this;
+  }
+  // Whether a call does nothing but work out its value
+  virtual bool isPure();
+  // Whether a call can be worked out by the C++ compiler
+  virtual bool isConstexpr();
+  // Whether a call always works, whatever it's given, and is pure
+  virtual bool isTotal() { return false; }
+  // If a call is the len() of something, the something
+  virtual NExpression *lengthOf(NExpressionArgs *args) { return NULL; }
+  // If looping over a call counts up from from, the value it stops short of
+  virtual NExpression *countsUp(NExpressionArgs *args, long long &from) {
+    return NULL;
+  }
+  // Whether a call hands back something lazy, which is only made into a
+  // list when it's kept as one
+  virtual bool isLazy() { return false; }
+  virtual void generateCallForArgs(Emitter &e, NExpressionArgs *args);
+  // The call as a part of a string concatenation
+  virtual void generateConcatPartForArgs(Emitter &e, NExpressionArgs *args) {
+    generateCallForArgs(e, args);
+  }
   virtual bool hasCustomIterator() { return false; }
-  virtual void generateItrCallForArgs(NIdentifier *id, NExpressionArgs *args) {
+  virtual void generateItrCallForArgs(Emitter &e, NIdentifier *id, NExpressionArgs *args) {
     throw std::runtime_error("This function is non-iterable");
   }
 
   virtual Type* get_type();
 };
 
+/*
+ * A root function with untyped parameters
+ * Rather than being parsed where it's declared, its tokens are parsed again
+ * for each set of argument types it gets called with. Each of those is a
+ * plain, fully typed C++ overload.
+ */
+class GenericFunctionDefinition : public FunctionDefinition {
+  // The ones made so far, by argument types
+  std::vector<std::pair<std::vector<Type *>, FunctionDefinition *>> versions;
+
+public:
+  string name;
+  // Decorators, header & block
+  std::vector<Token> tokens;
+  size_t params;
+  // Where it's declared
+  Scope *scope;
+
+  GenericFunctionDefinition(const string &name, std::vector<Token> &&tokens,
+                            size_t params, Scope *scope)
+    : FunctionDefinition(NULL), name(name), tokens(std::move(tokens)),
+      params(params), scope(scope) {}
+
+  /*
+   * Takes the generic functions out of the program's tokens, declaring them
+   * in scope instead. Tokens keep their lines, so errors still match up.
+   */
+  static void extract(Scope *scope, std::vector<Token> &tokens);
+
+  // Called by a specialization as it's declared
+  void add(const std::vector<Type *> &types, FunctionDefinition *def) {
+    versions.push_back(std::make_pair(types, def));
+  }
+
+  size_t versionCount() {
+    return versions.size();
+  }
+
+  virtual FunctionDefinition *specialize(NExpressionArgs *args);
+
+  // Only left as the definition when the call has the wrong number of args
+  virtual bool argsMatch(NExpressionArgs *args) { return false; }
+  virtual bool isPure() { return false; }
+  virtual bool isConstexpr() { return false; }
+  virtual Type* get_type();
+};
+
 class VariableDefinition : public Definition {
+  // matrixDims(), once it has been worked out
+  int dims;
 public:
   Type *type;
   bool hasGeneratedHeader;
-
-  VariableDefinition(Type *type) : type(type), hasGeneratedHeader(false) {}
+  // Set when it's reassigned or updated after being defined
+  bool mutated;
+  // How many times its value is read, and how many of those only look at
+  // it in place (indexing it, looping over it, taking its len)
+  int reads;
+  int borrows;
+  // What it's first assigned, if it's a plain local
+  NExpression *value;
+  // Reads left once the program has been folded, and whether any store
+  // to it does something besides store
+  int liveReads;
+  bool effectfulStores;
+  // For a range() loop's variable that nothing else changes, what it stays
+  // within - from, up to but not including below
+  long long from;
+  NExpression *below;
+
+  VariableDefinition(Type *type)
+    : type(type), hasGeneratedHeader(false), mutated(false), reads(0),
+      borrows(0), value(NULL), liveReads(0), effectfulStores(false),
+      from(0), below(NULL), dims(-1) {}
   virtual bool isVariable() { return true; }
+  // Whether the value ends up anywhere else - passed, returned, copied...
+  bool escapes() {
+    return reads > borrows;
+  }
+  // How many levels deep it's kept as one flat javelin::matrix, or 0
+  int matrixDims();
+  // Whether none of its stores need to be kept
+  bool isDead() {
+    return liveReads == 0 && ! effectfulStores;
+  }
   virtual Type* get_type();
   virtual void set_type(Type *type) {
     this->type = type;
@@ -52,9 +162,9 @@ public:
 // So we can modify the argument signature within a function block
 class ArgumentDefinition : public VariableDefinition {
 public:
-  NArgs *arg;
+  NArg *arg;
   
-  ArgumentDefinition(NArgs *arg);
+  ArgumentDefinition(NArg *arg);
   virtual void set_type(Type *type);
 
   virtual bool isVariable() { return true; }
@@ -67,33 +177,41 @@ public:
  */
 class Scope {
 protected:
-  std::unordered_map<string, Definition *> table;
+  std::unordered_map<Symbol, Definition *> table;
+  /*
+   * Every scope a lookup from here searches, outermost first - so resolving
+   * a name is a flat loop rather than a walk down the chain
+   */
+  std::vector<Scope *> path;
   void addStandardDefinitions();
 public:
   Scope *next;
+  // How many scopes enclose this one
+  int level;
 
-  Scope() {}
-  Scope(Scope *next) : next(next) {}
+  Scope() : next(NULL), level(0) {
+    path.push_back(this);
+  }
+  Scope(Scope *next) : path(next->path), next(next), level(next->level + 1) {
+    path.push_back(this);
+  }
 
   // Add a new definition to this scope table
-  void addDefinition(string name, Definition *definition);
+  void addDefinition(Symbol symbol, Definition *definition);
+  void addDefinition(const string &name, Definition *definition);
 
-  // Recursively find a definition in this, or a parent scope
-  virtual Definition * findDefinition(string name);
+  // Find a definition in this, or a parent scope
+  Definition * findDefinition(Symbol symbol);
 
-  // Compute the depth of the current scope
   int depth() {
-    return next ? 1 + next->depth() : 0;
+    return level;
   }
 };
 
 class FunctionScope : public Scope {
 public:
-  FunctionScope();
+  // Doesn't search parent scopes, but does have its own builtins
   FunctionScope(Scope *next, NFunctionDeclStatement *stmt);
-
-  // Doesn't search parent scopes, but does search a root scope
-  virtual Definition * findDefinition(string name);
 };
 
 // Handy root scope class to handle built in functions
@@ -122,10 +240,3 @@ public:
     this->type = type;
   }
 };
-
-/*
- * The top scope - it will change when the parser enters a new block
- * Statements and expressions latch on to this, but it "moves up and down"
- */
-extern Scope *currentScope;
-extern FunctionStack *funcStack;
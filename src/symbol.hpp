@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Identifiers get interned to one of these when they are lexed
+typedef int Symbol;
+
+/*
+ * Hands out a small integer per distinct name, so scopes never have to hash
+ * (or copy) the same string over and over.
+ */
+class SymbolTable {
+  std::unordered_map<std::string, Symbol> symbols;
+  // Points at the keys above, which stay put as the map grows
+  std::vector<const std::string *> names;
+
+public:
+  Symbol intern(const std::string &name) {
+    auto itr = symbols.find(name);
+    if (itr != symbols.end()) {
+      return itr->second;
+    }
+    Symbol symbol = names.size();
+    names.push_back(&symbols.emplace(name, symbol).first->first);
+    return symbol;
+  }
+
+  const std::string& name(Symbol symbol) const {
+    return *names[symbol];
+  }
+};
@@ -0,0 +1,161 @@
+#include <string>
+#include <vector>
+
+#include "node.hpp"
+#include "passes.hpp"
+
+// Whether anything in what it walks calls func
+class SelfCallFinder : public NVisitor {
+public:
+  NFunctionDeclStatement *func;
+  bool found;
+
+  SelfCallFinder(NFunctionDeclStatement *func) : func(func), found(false) {}
+
+  virtual void visit(NExpression *expr) {
+    if (expr->self_call(func)) found = true;
+  }
+};
+
+NFunctionCallExpression *
+NBinaryOperator::accumulated_call(NFunctionDeclStatement *func, NOpType &op,
+                                  NExpression *&rest) {
+  // Only ones that are fine with being regrouped and reordered
+  switch (this->op) {
+  case N_ADD:
+    if (isStringConcat()) return NULL;
+    break;
+  case N_MUL: case N_BA: case N_BO: case N_BX:
+    break;
+  default:
+    return NULL;
+  }
+
+  NExpression *other = lhs;
+  NFunctionCallExpression *call = rhs->self_call(func);
+  if (call == NULL) {
+    other = rhs;
+    call = lhs->self_call(func);
+  }
+  if (call == NULL || other->has_side_effects()) return NULL;
+
+  SelfCallFinder finder(func);
+  other->walk(finder);
+  if (finder.found) return NULL;
+
+  op = this->op;
+  rest = other;
+  return call;
+}
+
+// What javelin_acc starts off as, so that it changes nothing
+static int identity(NOpType op) {
+  switch (op) {
+  case N_MUL: return 1;
+  case N_BA: return -1;
+  default: return 0;
+  }
+}
+
+void NFunctionDeclStatement::generateBody(Emitter &e) {
+  if (accumulates) {
+    e.line() << type->cpp_type_string() << " javelin_acc = "
+             << identity(accumulator) << ";\n";
+  }
+  if (loops) e.line() << "javelin_tail:\n";
+  stmt->generate(e);
+}
+
+void NReturn::generate(Emitter &e) {
+  if (tailCall) {
+    generateTailCall(e);
+    return;
+  }
+
+  NStatement::generate(e);
+  e << "return ";
+  if (expr && func->accumulates) {
+    // Whatever the calls before this one left to do
+    int precedence = NOpType_precedence(func->accumulator);
+    e << "javelin_acc " << NOpType_str(func->accumulator) << ' ';
+    expr->generate_operand(e, precedence + 1);
+  } else if (expr) {
+    expr->generate(e);
+  }
+  e << ";\n";
+}
+
+void NReturn::generateTailCall(Emitter &e) {
+  NArgs *params = func->args;
+  NExpressionArgs *args = tailCall->args;
+
+  // The parameters passed straight through can stay as they are
+  std::vector<size_t> changed;
+  for (size_t i = 0; i < params->size(); i++) {
+    if ( ! (*args)[i]->refersTo((*params)[i]->definition)) changed.push_back(i);
+  }
+
+  // Every argument is worked out before any parameter changes
+  std::vector<string> temps(params->size());
+  if (changed.size() > 1) {
+    for (size_t i : changed) {
+      temps[i] = e.temp("next");
+      e.line() << (*params)[i]->get_type()->cpp_type_string() << ' '
+               << temps[i] << " = ";
+      (*args)[i]->generate(e);
+      e << ";\n";
+    }
+  }
+  if (accumulated) {
+    e.line() << "javelin_acc " << NOpType_str(func->accumulator) << "= ";
+    accumulated->generate(e);
+    e << ";\n";
+  }
+  for (size_t i : changed) {
+    e.line() << (*params)[i]->id->name << " = ";
+    if (temps[i].empty()) {
+      (*args)[i]->generate(e);
+    } else if ((*params)[i]->get_type()->isCheapToCopy()) {
+      e << temps[i];
+    } else {
+      e << "std::move(" << temps[i] << ')';
+    }
+    e << ";\n";
+  }
+  e.line() << "goto javelin_tail;\n";
+}
+
+void eliminate_tail_calls(Context *ctx) {
+  for (NFunctionDeclStatement *func : ctx->funcStmts) {
+    // @cache wants every call to go through the cache
+    if (func->cached) continue;
+
+    for (NReturn *ret : func->returns) {
+      if (ret->expr == NULL) continue;
+
+      ret->tailCall = ret->expr->self_call(func);
+      if (ret->tailCall) {
+        func->loops = true;
+        continue;
+      }
+
+      // Only the one kind of accumulator - the rest stay as plain calls
+      NOpType op;
+      NExpression *rest;
+      NFunctionCallExpression *call = ret->expr->accumulated_call(func, op, rest);
+      if (call && ( ! func->accumulates || func->accumulator == op)) {
+        func->loops = func->accumulates = true;
+        func->accumulator = op;
+        ret->tailCall = call;
+        ret->accumulated = rest;
+      }
+    }
+
+    // The parameters double as the loop's variables
+    if (func->loops) {
+      for (NArg *arg : func->args->args) {
+        arg->definition->mutated = true;
+      }
+    }
+  }
+}
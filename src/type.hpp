@@ -2,6 +2,10 @@
 
 #include <string>
 #include <stdexcept>
+#include <unordered_map>
+
+#include "arena.hpp"
+
 using std::string;
 
 class Type {
@@ -14,6 +18,8 @@ public:
   virtual bool isVoid() { return false; }
   virtual bool isIndexible() { return false; }
   virtual bool isIndAssignible() { return false; }
+  // Whether passing it around by value costs next to nothing
+  virtual bool isCheapToCopy() { return false; }
   virtual std::string get_cpp_len_function() {
     throw std::runtime_error("A " + cpp_type_string() + " has no length");
   }
@@ -42,6 +48,7 @@ public:
   virtual string cpp_type_string() {
     return type;
   };
+  virtual bool isCheapToCopy() { return true; }
 };
 
 class StringType : public Type {
@@ -56,18 +63,23 @@ public:
     return ".length()";
   }
   virtual Type* get_itr_type() {
-    return new StringType();
+    return this;
   };
   virtual bool isIndexible() { return true; }
 };
 
 class ListType : public Type {
   Type *itr_type;
+  // Built on first use, nested lists would otherwise rebuild it recursively
+  string cpp_type;
 public:
   ListType(Type *itr_type) : itr_type(itr_type) {}
 
   virtual string cpp_type_string() {
-    return "std::vector<" + itr_type->cpp_type_string() + ">";
+    if (cpp_type.empty()) {
+      cpp_type = "std::vector<" + itr_type->cpp_type_string() + ">";
+    }
+    return cpp_type;
   };
 
   virtual Type* get_itr_type() {
@@ -75,8 +87,51 @@ public:
   };
 
   virtual std::string get_cpp_len_function() {
-    return ".length()";
+    return ".size()";
   }
   virtual bool isIndexible() { return true; }
   virtual bool isIndAssignible() { return true; }
 };
+
+/*
+ * Hands out one canonical object per structural type
+ * Types from the same context are equal exactly when their pointers are.
+ */
+class TypeContext {
+  Arena &arena;
+  UnsetType *unset;
+  VoidType *voidType;
+  StringType *stringType;
+  std::unordered_map<std::string, BasicType*> basics;
+  std::unordered_map<Type*, ListType*> lists;
+  BasicType *intType;
+
+public:
+  TypeContext(Arena &arena) : arena(arena) {
+    unset = arena.make<UnsetType>();
+    voidType = arena.make<VoidType>();
+    stringType = arena.make<StringType>();
+    intType = get_basic("int");
+  }
+
+  Type* get_unset() { return unset; }
+  VoidType* get_void() { return voidType; }
+  StringType* get_string() { return stringType; }
+  BasicType* get_int() { return intType; }
+
+  BasicType* get_basic(const std::string &name) {
+    BasicType *&type = basics[name];
+    if (type == NULL) {
+      type = arena.make<BasicType>(name);
+    }
+    return type;
+  }
+
+  ListType* get_list(Type *itr_type) {
+    ListType *&type = lists[itr_type];
+    if (type == NULL) {
+      type = arena.make<ListType>(itr_type);
+    }
+    return type;
+  }
+};
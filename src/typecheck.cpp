@@ -0,0 +1,24 @@
+#include <stdexcept>
+
+#include "node.hpp"
+#include "passes.hpp"
+
+// Pins down every expression's type, which get_type() then hands back as is
+class TypeChecker : public NVisitor {
+public:
+  virtual void visit(NExpression *expr) {
+    if (expr->get_type()->isUnset()) {
+      throw std::runtime_error("Could not infer the type of an expression");
+    }
+  }
+};
+
+void typecheck(Context *ctx) {
+  TypeChecker checker;
+  for (NStatement *stmt : ctx->rootStmts) {
+    stmt->walk(checker);
+  }
+  for (NFunctionDeclStatement *stmt : ctx->rootFuncStmts) {
+    stmt->walk(checker);
+  }
+}
@@ -0,0 +1,51 @@
+def count(n: int):
+    total = 0
+    for i in range(n):
+        total += i
+    return total
+
+def greet(name):
+    name += "!"
+    return name
+
+print("Ints:")
+x = 7
+x += 3
+x -= 1
+x *= 4
+x /= 2
+x %= 5
+x <<= 3
+x |= 1
+print(x, count(10))
+y = -7
+y %= 3
+print(y)
+
+print("Strings:")
+s = "java"
+s += "lin"
+s = s + " is " + str(x) + " chars"
+s += s
+print(s, greet("hey"))
+for c in "abc":
+    s = s + c
+print(s)
+
+print("Lists:")
+xs = [1]
+xs += [2]
+xs = xs + [3, 4]
+ys = [5]
+xs += ys
+xs += xs
+for v in xs:
+    print(v)
+
+print("Itself:")
+t = "ab"
+t += "-" + t
+print(t)
+u = "ab"
+u = u + "c" + u
+print(u)
@@ -0,0 +1,35 @@
+def days_in(month: int) -> int:
+    # Looked up on every call, but only ever built once
+    days = [31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31]
+    return days[month]
+
+def total(xs):
+    xs += [0]
+    count = 0
+    for x in xs:
+        count += x
+    return count
+
+print("Lookup tables:")
+year = 0
+for month in range(12):
+    year += days_in(month)
+print(year)
+
+offsets = [-1, 0, 1]
+print(len(offsets), offsets[0], offsets[2])
+
+print("Handed on:")
+primes = [2, 3, 5, 7]
+print(total(primes))
+
+print("Changed later:")
+names = ["ann", "bob"]
+names += ["cy"]
+for name in names:
+    print(name)
+
+print("Looped over:")
+for word in ["one", "two"]:
+    for n in [1, -2]:
+        print(word, n)
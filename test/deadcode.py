@@ -0,0 +1,77 @@
+def noisy(n: int) -> int:
+    print("noisy", n)
+    return n
+
+def helper(n: int) -> int:
+    return n * 2
+
+def used(n: int) -> int:
+    def inner(m: int) -> int:
+        return m + 1
+    def unused(m: int) -> int:
+        return m - 1
+    return inner(n)
+
+def never(n: int) -> int:
+    return n + 1
+
+def also_never():
+    print("never printed")
+
+print("Calls:")
+print(used(helper(4)))
+
+print("Stores:")
+scratch = 5 * 7
+scratch += 1
+kept = noisy(3)
+listed = [noisy(6), 7]
+total = 0
+for i in range(4):
+    total += i
+    unread = total * 2
+print(total)
+
+print("Updates:")
+count = 0
+count = count + 1
+steps = 0
+steps += 1
+z = 10
+z = 20
+print(z)
+table = [4, 5, 6]
+first = table[0] + never(2)
+w = 1
+while w < 100:
+    w = w * 3
+    w = w + 1
+print(w)
+
+print("Jumps:")
+x = 0
+j = 0
+while j < 10:
+    x = j
+    if j == 5:
+        break
+    x = 100
+    j += 1
+print(x)
+y = 0
+j = 0
+while j < 10:
+    y = j
+    if j < 3:
+        j += 1
+    else:
+        break
+    y = 100
+print(y)
+last = 0
+for k in range(5):
+    last = k
+    if k % 2 == 0:
+        continue
+    last = -1
+print(last)
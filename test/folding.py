@@ -0,0 +1,51 @@
+print("Arithmetic:")
+print(2 + 3 * 4, (2 + 3) * 4, 7 - (2 - 1), -(3 - 5), 1 << 4, 6 & 3 | 8)
+print(-7 % 3, 7 % -3, 2 * -3 % 4, int(1 < 2), int(not 0))
+
+print("Strings:")
+print("java" + "lin", str(24) + str("hi"), int("123") + 1, len("four"))
+print(int("a" == "a"), int("a" != "a"), len([1, 2, 3]))
+
+print("Propagated:")
+width = 8
+height = width * 2
+name = "grid"
+label = name + str(height)
+print(width * height, label, len(label))
+
+print("Brackets kept:")
+x = 5
+x += 1
+print(x * (x + 1), int((x & 3) == 2), -(x - 10), (x - 1) - (x - 2))
+
+print("Branches:")
+if 0:
+    print("never")
+elif width > 4:
+    size = "big"
+    print(size)
+else:
+    print("small")
+
+if height < 10:
+    print("short")
+elif x:
+    print("x is set")
+elif 1:
+    print("fallback")
+else:
+    print("never")
+
+while 0:
+    print("never")
+
+if 1:
+    size = 3
+    print(size)
+
+def negate_twice(n: int):
+    return - -n
+
+flip = 4
+flip += 1
+print(- -flip, -(-flip), - -negate_twice(flip), flip)
@@ -0,0 +1,41 @@
+# Untyped parameters get a version of the function for each type passed in
+def twice(x):
+  return x + x
+
+def first(items):
+  for item in items:
+    return item
+  return items[0]
+
+def describe(label, value):
+  return label + ": " + str(value)
+
+# Versions can call each other
+def wrap(x, depth):
+  if depth == 0:
+    return str(x)
+  return wrap("(" + str(x) + ")", depth - 1)
+
+@cache
+def steps(n):
+  if n <= 1:
+    return 0
+  return 1 + steps(n - 2)
+
+def pick(flag, a, b):
+  # Comments and blank lines in the block are fine
+
+  if flag:
+    return a
+  return b
+
+# Never called, so never typed
+def unused(a, b):
+  return a - b
+
+print(twice(21), twice("ab"))
+print(first([4, 5]), first(["x", "y"]))
+print(describe("count", 3), describe("name", "bob"))
+print(steps(50), steps(7))
+print(wrap(7, 3), wrap("x", 1))
+print(pick(1, 2, 3), pick(0, "a", "b"))
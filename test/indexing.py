@@ -0,0 +1,36 @@
+def last(xs):
+    return xs[-1]
+
+def get(s, i):
+    return s[i]
+
+def total(xs):
+    sum = 0
+    for i in range(len(xs)):
+        sum += xs[i] * i
+    return sum
+
+print("Negative:")
+primes = [2, 3, 5, 7, 11]
+print(primes[-1], primes[-5], primes[0])
+fib = [1, 1]
+fib += [2, 3, 5, 8]
+print(last(fib), last([4]))
+back = -2
+print(fib[back], fib[back - 1])
+
+print("Strings:")
+word = "javelin"
+print(word[0], word[-1], word[3] + word[4])
+first = word[0]
+print(first == "j", word[1] < word[2], word[5] >= "i", len(word[2]))
+
+print("Counted:")
+print(total(fib), total(primes))
+for k in range(2, len(word)):
+    print(word[k])
+
+print("Out of range:")
+unused = get(word, 2)
+ignored = fib[len(fib)]
+print("not reached")
@@ -0,0 +1,60 @@
+def count_down(n: int) -> int:
+    steps = 0
+    while n > 0:
+        steps += 1
+        n = n - 2
+    return steps
+
+def label(prefix: str, n: int) -> str:
+    out = ""
+    i = 0
+    while i < n:
+        out += prefix + "-" + str(n) + ";"
+        i = i + 1
+    return out
+
+print("Counted:")
+xs = [3, 1, 4, 1, 5, 9, 2, 6]
+i = 0
+total = 0
+while i < len(xs):
+    total += xs[i] * len(xs)
+    i += 1
+print(total, i)
+print(count_down(7), count_down(0))
+print(label("ab", 3))
+
+print("Skipping:")
+j = 0
+odd = 0
+while j < len(xs):
+    j += 1
+    if xs[j - 1] % 2 == 0:
+        continue
+    odd += xs[j - 1]
+print(odd)
+
+print("Growing:")
+ys = [1]
+while len(ys) < 5:
+    ys += [len(ys) * 2]
+for y in ys:
+    print(y)
+
+print("Nested:")
+grid = [[1, 2, 3], [4, 5], [6]]
+r = 0
+while r < len(grid):
+    c = 0
+    row = ""
+    while c < len(grid[r]):
+        row = row + str(grid[r][c]) + " "
+        c += 1
+    print(row + "/ " + str(len(grid)))
+    r += 1
+
+print("Stepping:")
+k = 10
+while k >= 0:
+    print(k)
+    k -= 4
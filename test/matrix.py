@@ -0,0 +1,39 @@
+def row_sum(row):
+    row += [0]
+    total = 0
+    for x in row:
+        total += x
+    return total
+
+print("Grids:")
+grid = [[1, 2, 3], [4, 5, 6]]
+print(len(grid), len(grid[0]), grid[1][2])
+total = 0
+i = 0
+while i < len(grid):
+    j = 0
+    while j < len(grid[i]):
+        total += grid[i][j] * i
+        j += 1
+    i += 1
+print(total)
+for row in grid:
+    print(row_sum(row))
+
+print("Cubes:")
+n = 2
+cube = [[[n, n + 1], [n + 2, n + 3]], [[n + 4, n + 5], [n + 6, n + 7]]]
+for plane in cube:
+    for row in plane:
+        for cell in row:
+            print(cell)
+print(cube[1][0][1], len(cube[1]), row_sum(cube[0][1]))
+
+print("Ragged:")
+tri = [[1], [2, 3]]
+print(tri[1][1], len(tri[1]))
+
+print("Strings:")
+names = [["a", "b"], ["c", "d"]]
+for name in names[1]:
+    print(name)
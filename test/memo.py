@@ -0,0 +1,63 @@
+# Without the cache, this would make hundreds of millions of calls
+@cache
+def paths(right: int, down: int) -> int:
+  if right == 0 or down == 0:
+    return 1
+  return paths(right - 1, down) + paths(right, down - 1)
+
+# The body only runs once per argument, so this only prints once
+@cache
+def noisy(word: str) -> str:
+  print("working out", word)
+  return word + word
+
+@lru_cache
+def steps(n: int) -> int:
+  if n == 1:
+    return 0
+  if n % 2 == 0:
+    return 1 + steps(n / 2)
+  return 1 + steps(3 * n + 1)
+
+# Pure, and simple enough to be constexpr
+def square(x: int) -> int:
+  return x * x
+
+def sign(x: int) -> int:
+  if x < 0:
+    return -1
+  elif x == 0:
+    return 0
+  return 1
+
+print(paths(16, 16))
+first = noisy("ab")
+again = noisy("ab")
+print(first, again)
+print(noisy("cd"))
+
+longest = 0
+for n in range(1, 10000):
+  count = steps(n)
+  if count > longest:
+    longest = count
+print(longest)
+
+print(square(12), square(longest), sign(-5), sign(0), sign(square(3)))
+
+# Nested ones call themselves through a std::function
+def ways(n: int) -> int:
+  @cache
+  def climb(k: int) -> int:
+    if k < 2:
+      return 1
+    return climb(k - 1) + climb(k - 2)
+
+  def depth(k: int) -> int:
+    if k == 0:
+      return 0
+    return 1 + depth(k / 2)
+
+  return climb(n) + depth(n)
+
+print(ways(40))
@@ -0,0 +1,6 @@
+print("Several values:", 1, -23, "end")
+print()
+print("Flushed straight away", flush=True)
+done = False
+print("Flushed only if done", flush=done)
+print(True, False)
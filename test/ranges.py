@@ -0,0 +1,55 @@
+def steps(start: int, stop: int, by: int) -> int:
+    count = 0
+    for v in range(start, stop, by):
+        count += 1
+    return count
+
+print("Steps:")
+for i in range(0, 10, 3):
+    print(i)
+
+print("Backwards:")
+for j in range(5, 0, -2):
+    print(j)
+
+print("Step from a variable:")
+step = -1
+for k in range(3, -1, step):
+    print(k)
+
+print("Nothing to do:")
+for m in range(3, 3):
+    print(m)
+
+print("As values:")
+evens = range(0, 10, 2)
+print(len(evens), len(range(100)), range(5, 50, 5)[3])
+evens += range(3)
+sum = 0
+for x in evens:
+    sum += x
+print(len(evens), sum)
+
+print("Lazy:")
+fives = range(5, 50, 5)
+print(len(fives), fives[3], fives[-1])
+for f in fives:
+    sum -= f
+print(sum)
+
+print("Moved on:")
+for a in range(0, 10, 2):
+    print(a)
+    a = a + 2
+for b in range(3, 0, step):
+    b = 0
+    print(b)
+
+print("Near the top:")
+top = 2147483647
+for n in range(top - 7, top, 3):
+    print(n)
+near = range(top - 7, top, 3)
+for w in near:
+    print(w)
+print(steps(top - 7, top, 3), steps(-top, -top + 5, -2), steps(-top, -top + 5, 2))
@@ -0,0 +1,25 @@
+def shout(word: str) -> str:
+    return word + "!"
+
+def pad(word: str, n: int) -> str:
+    while n > 0:
+        word = " " + word
+        n -= 1
+    return word
+
+print("Parameters:")
+greeting = "hello"
+print(shout(greeting), pad(greeting, 3), greeting)
+
+print("Nested lists:")
+grid = [[1, 2, 3], [4, 5], [6]]
+total = 0
+for row in grid:
+    for cell in row:
+        total += cell
+print(total)
+
+print("Reassigned loop variables:")
+for name in ["ab", "cd"]:
+    name += "?"
+    print(name)
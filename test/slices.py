@@ -0,0 +1,57 @@
+def total(xs):
+    sum = 0
+    for x in xs:
+        sum += x
+    return sum
+
+def tail(s):
+    return s[1:]
+
+def show(s):
+    rest = s[3:]
+    for c in rest:
+        print(c)
+    print(len(rest), rest, rest[1:3], rest[-1])
+
+print("Lists:")
+nums = [1, 2, 3, 4, 5, 6]
+nums += [7]
+print(total(nums[2:5]), total(nums[:3]), total(nums[4:]), total(nums[:]))
+print(total(nums[-3:]), total(nums[:-5]), total(nums[5:2]), total(nums[-100:100]))
+print(len(nums[1:4]), nums[1:][0], nums[2:6][-1], nums[1:][1:][1:][0])
+
+print("Strings:")
+word = "javelin"
+word += "!"
+print(word[1:4], word[:3], word[3:], word[-4:-1], word[6:2] + "|", word[:])
+print(len(word[2:]), word[2:][1], tail(word), tail(word[4:]))
+print(word[2:5] == "vel", word[:3] + word[3:] + str(nums[1:][0]))
+
+print("Views:")
+digits = [3, 1, 4, 1, 5, 9, 2, 6]
+middle = digits[1:-1]
+for n in middle:
+    print(n)
+print(len(middle), middle[0], middle[2:][-1])
+show("slicing")
+
+print("Copies:")
+kept = nums[:2]
+kept += [10]
+handed = word[:4]
+print(total(kept), total(nums), tail(handed))
+start = word[1:]
+start += start[2:]
+print(start, word)
+word += word[5:]
+print(word)
+nums += nums[4:]
+print(total(nums), len(nums))
+
+print("Others:")
+r = range(10, 30, 2)
+print(total(r[2:5]), len(r[-3:]))
+grid = [[1, 2, 3], [4, 5, 6], [7, 8, 9]]
+print(total(grid[1][1:]), len(grid[1:]), grid[1:][1][0])
+for row in grid[:2]:
+    print(total(row[:2]))
@@ -0,0 +1,59 @@
+/*
+ * Thread-safety stress test for libjavelin
+ * Transpiles every file given on the command line from many threads at once,
+ * and checks each result against a single threaded run.
+ */
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/javelin.hpp"
+
+const int THREADS = 16;
+const int ROUNDS = 50;
+
+bool sameResult(const javelin::Result &a, const javelin::Result &b) {
+  return a.success == b.success && a.output == b.output &&
+    a.error == b.error && a.line == b.line;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> sources;
+  std::vector<javelin::Result> expected;
+
+  for (int i = 1; i < argc; i++) {
+    std::ifstream file(argv[i]);
+    std::stringstream source;
+    source << file.rdbuf();
+    sources.push_back(source.str());
+    expected.push_back(javelin::transpile(source.str()));
+  }
+
+  std::atomic<int> failures(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; t++) {
+    threads.push_back(std::thread([&, t] () {
+      for (int round = 0; round < ROUNDS; round++) {
+        // Stagger the order, so different files are in flight at once
+        for (size_t i = 0; i < sources.size(); i++) {
+          size_t file = (i + t + round) % sources.size();
+          if ( ! sameResult(javelin::transpile(sources[file]), expected[file])) {
+            fprintf(stderr, "Mismatch transpiling %s\n", argv[file + 1]);
+            failures++;
+          }
+        }
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  printf("%d threads x %d rounds x %zu files: %d failures\n",
+         THREADS, ROUNDS, sources.size(), failures.load());
+  return failures ? 1 : 0;
+}
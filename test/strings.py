@@ -0,0 +1,34 @@
+def shout(s: str) -> str:
+    return s + "!"
+
+print("Characters of a variable:")
+word = "javelin"
+for c in word:
+    print(c)
+
+print("Characters of a function result:")
+for d in shout("hey"):
+    print(d, len(d))
+
+print("Building strings from characters:")
+reversed = ""
+vowels = 0
+for e in word:
+    reversed = e + reversed
+    if e == "a" or e == "e" or e == "i":
+        vowels = vowels + 1
+print(reversed, vowels)
+
+doubled = ""
+for f in "abc":
+    doubled = doubled + f + f
+print(str(doubled))
+
+print("Reassigning characters:")
+for g in "xyz":
+    g = g + "!"
+    print(g)
+for h in word:
+    h = "-"
+    doubled += h
+print(doubled)
@@ -0,0 +1,51 @@
+# Calls that are the last thing a function does become jumps back to the top
+def gcd(a: int, b: int) -> int:
+  if b == 0:
+    return a
+  return gcd(b, a % b)
+
+def count_down(n: int, steps: int) -> int:
+  if n == 0:
+    return steps
+  return count_down(n - 1, steps + 1)
+
+# Strings get moved along, not copied
+def pad(s: str, width: int) -> str:
+  if len(s) >= width:
+    return s
+  return pad(s + ".", width)
+
+# Whatever is left to do after the call gets carried along instead
+def factorial(n: int) -> int:
+  if n <= 1:
+    return 1
+  return n * factorial(n - 1)
+
+def total(n: int) -> int:
+  if n == 0:
+    return 0
+  elif n % 2 == 0:
+    return total(n - 1) + n * 2
+  return n + total(n - 1)
+
+# Only one kind of accumulator - the + stays a plain call
+def mixed(n: int) -> int:
+  if n <= 0:
+    return 1
+  if n % 3 == 0:
+    return 2 * mixed(n - 1)
+  return mixed(n - 1) + 1
+
+# Nested functions can call themselves, when it's the last thing they do
+def digits(n: int) -> int:
+  def step(left: int, found: int) -> int:
+    if left < 10:
+      return found + 1
+    return step(left / 10, found + 1)
+  return step(n, 0)
+
+print(gcd(1071, 462), gcd(17, 5))
+print(count_down(900000, 0))
+print(pad("ab", 6), len(pad("", 50000)))
+print(factorial(10), total(100), mixed(10))
+print(digits(7), digits(12345), digits(1000000))
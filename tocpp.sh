@@ -1,2 +1,5 @@
 #!/bin/sh
-./bin/scopeParser < $1 | ./bin/javelinParser
+# Anything after the file goes to the transpiler, e.g. --memoize
+FILE=$1
+shift
+./bin/javelinParser "$@" < $FILE